@@ -35,23 +35,31 @@ function check_project_struct {
   find_file_or_dir_in_project ${PROJECT_PATH} venmo_output
 }
 
-# setup testing output folder
+# setup testing output folder, the sources are copied and built once
+# for all tests
 function setup_testing_input_output {
   TEST_OUTPUT_PATH=${GRADER_ROOT}/temp
-  if [ -d ${TEST_OUTPUT_PATH} ]; then
+  if [ ! -d ${TEST_OUTPUT_PATH}/src ]; then
     rm -rf ${TEST_OUTPUT_PATH}
+    mkdir -p ${TEST_OUTPUT_PATH}
+    cp -r ${PROJECT_PATH}/src ${TEST_OUTPUT_PATH}
   fi
+  rm -rf ${TEST_OUTPUT_PATH}/run.sh ${TEST_OUTPUT_PATH}/venmo_input \
+    ${TEST_OUTPUT_PATH}/venmo_output
 
-  mkdir -p ${TEST_OUTPUT_PATH}
-
-  cp -r ${PROJECT_PATH}/src ${TEST_OUTPUT_PATH}
   cp -r ${PROJECT_PATH}/run.sh ${TEST_OUTPUT_PATH}
   cp -r ${PROJECT_PATH}/venmo_input ${TEST_OUTPUT_PATH}
   cp -r ${PROJECT_PATH}/venmo_output ${TEST_OUTPUT_PATH}
 
-  rm -r ${TEST_OUTPUT_PATH}/venmo_input/*
-  rm -r ${TEST_OUTPUT_PATH}/venmo_output/*
-  cp -r ${GRADER_ROOT}/tests/${test_folder}/venmo_input/venmo-trans.txt ${TEST_OUTPUT_PATH}/venmo_input/venmo-trans.txt
+  rm -rf ${TEST_OUTPUT_PATH}/venmo_input/*
+  rm -rf ${TEST_OUTPUT_PATH}/venmo_output/*
+  # all input files of the test, and its own run.sh if it has one,
+  # which runs the program with the options under test and writes
+  # venmo_output/output.txt
+  cp -r ${GRADER_ROOT}/tests/${test_folder}/venmo_input/. ${TEST_OUTPUT_PATH}/venmo_input/
+  if [ -f ${GRADER_ROOT}/tests/${test_folder}/run.sh ]; then
+    cp ${GRADER_ROOT}/tests/${test_folder}/run.sh ${TEST_OUTPUT_PATH}/run.sh
+  fi
 }
 
 function compare_outputs {
@@ -72,6 +80,7 @@ function run_all_tests {
   TEST_FOLDERS=$(ls ${GRADER_ROOT}/tests)
   NUM_TESTS=$(echo $(echo ${TEST_FOLDERS} | wc -w))
   PASS_CNT=0
+  rm -rf ${GRADER_ROOT}/temp
 
   # Loop through all tests
   for test_folder in ${TEST_FOLDERS}; do
@@ -0,0 +1,16 @@
+#!/usr/bin/env bash
+
+## --start-at in the middle of out of order input, once reading from the
+## start and once seeking with a time index of a sample every 100 lines,
+## both must write the medians of the full run from that record on
+cd ./src/
+make > /dev/null && make mktidx > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median --start-at 2016-04-07T04:13:58Z ./venmo_input/venmo-trans.txt ./venmo_output/scan.txt
+  cp ./venmo_input/venmo-trans.txt ./venmo_output/indexed.txt
+  ./src/mktidx -n 100 ./venmo_output/indexed.txt > /dev/null
+  ./src/rolling_median --start-at 1460002438 ./venmo_output/indexed.txt ./venmo_output/seek.txt
+  cat ./venmo_output/scan.txt ./venmo_output/seek.txt > ./venmo_output/output.txt
+fi
@@ -0,0 +1,16 @@
+#!/usr/bin/env bash
+
+## windows of 60, 300 and 600 seconds with all but the newest 20 seconds
+## of each ring spilled to disk, which must not change the medians, and
+## a limit on live edges that this input exceeds, see src/spill.h
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  mkdir -p ./venmo_output/spill
+  ./src/rolling_median --windows 60,300,600 --spill ./venmo_output/spill:20 ./venmo_input/venmo-trans.txt ./venmo_output/output.txt 2> /dev/null
+  if ! ./src/rolling_median --windows 60,300,600 --spill ./venmo_output/spill:20:100 ./venmo_input/venmo-trans.txt ./venmo_output/limited.txt 2> /dev/null ; then
+    echo "edge limit refused" >> ./venmo_output/output.txt
+  fi
+fi
@@ -0,0 +1,14 @@
+#!/usr/bin/env bash
+
+## the compile-time specialized engine, undirected and with --directed,
+## where (actor, target) and (target, actor) are different edges, see
+## src/tgraph.h
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median --engine static ./venmo_input/venmo-trans.txt ./venmo_output/undirected.txt
+  ./src/rolling_median --engine static --directed ./venmo_input/venmo-trans.txt ./venmo_output/directed.txt
+  cat ./venmo_output/undirected.txt ./venmo_output/directed.txt > ./venmo_output/output.txt
+fi
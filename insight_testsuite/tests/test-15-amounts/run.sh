@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+## minimum, median, 0.9 quantile and maximum of amounts in the window,
+## with amounts in quotes, rounded to cents, and records rejected for
+## negative, too large or non-numeric amounts, see src/amounts.h
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median --amounts 0,0.5,0.9,1 ./venmo_input/venmo-trans.txt ./venmo_output/output.txt
+fi
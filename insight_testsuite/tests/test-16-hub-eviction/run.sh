@@ -0,0 +1,14 @@
+#!/usr/bin/env bash
+
+## hubs losing many edges in one evicted second, with jumps that evict
+## several seconds at once, without and with --top, whose listing of the
+## four highest degree nodes every 250 records follows the medians
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median ./venmo_input/venmo-trans.txt ./venmo_output/plain.txt
+  ./src/rolling_median --top 4:250 ./venmo_input/venmo-trans.txt ./venmo_output/top.txt 2> ./venmo_output/hubs.txt
+  cat ./venmo_output/plain.txt ./venmo_output/top.txt ./venmo_output/hubs.txt > ./venmo_output/output.txt
+fi
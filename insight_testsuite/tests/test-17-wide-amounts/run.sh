@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+## records whose amount is negative, null, a word or too large, parsed
+## with --wide but without --amounts, so the amount is skipped and the
+## medians are those of the records without it
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median --wide ./venmo_input/venmo-trans.txt ./venmo_output/output.txt
+fi
@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+
+## connected components and largest component after each median, with
+## seconds evicted, late and out of order records, see src/dynconn.h
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median --components ./venmo_input/venmo-trans.txt ./venmo_output/output.txt
+fi
@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+
+## three input files processed as one stream with one output each, so
+## the concatenated outputs equal those of a single file, see
+## src/venmofeed.h; then two inputs that would share an output file
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median --outdir ./venmo_output/parts ./venmo_input/part-1.txt \
+    ./venmo_input/part-2.txt ./venmo_input/part-3.txt
+  cat ./venmo_output/parts/part-1.txt ./venmo_output/parts/part-2.txt \
+    ./venmo_output/parts/part-3.txt > ./venmo_output/output.txt
+  if ! ./src/rolling_median --outdir ./venmo_output/same \
+      ./venmo_input/part-1.txt ./venmo_input/part-1.txt 2> /dev/null ; then
+    echo "shared output refused" >> ./venmo_output/output.txt
+  fi
+fi
@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+
+## gzip input, and a gzip stream cut in half, which must be refused;
+## the same for zstd if this build reads it, see src/decompress.h
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median ./venmo_input/venmo-trans.txt.gz ./venmo_output/output.txt
+  if ! ./src/rolling_median ./venmo_input/truncated.txt.gz \
+      ./venmo_output/truncated.txt 2> /dev/null ; then
+    echo "truncated gzip refused" >> ./venmo_output/output.txt
+  fi
+  # zstd support is optional, its outputs are compared here
+  if ./src/rolling_median ./venmo_input/venmo-trans.txt.zst \
+      ./venmo_output/zstd.txt 2> ./venmo_output/zstd.err ; then
+    head -n -1 ./venmo_output/output.txt | cmp -s - ./venmo_output/zstd.txt \
+      || echo "zstd output differs" >> ./venmo_output/output.txt
+    if ./src/rolling_median ./venmo_input/truncated.txt.zst \
+        ./venmo_output/truncated.txt 2> /dev/null ; then
+      echo "truncated zstd accepted" >> ./venmo_output/output.txt
+    fi
+  elif ! grep -q "does not support" ./venmo_output/zstd.err ; then
+    echo "zstd input failed" >> ./venmo_output/output.txt
+  fi
+fi
@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+
+## approx engine with the default budget, which tracks every node of
+## this input and so must give the exact medians, see src/approxgraph.h
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median --engine approx ./venmo_input/venmo-trans.txt ./venmo_output/output.txt 2> /dev/null
+fi
@@ -0,0 +1,15 @@
+#!/usr/bin/env bash
+
+## binary output with edge and node columns, converted back to text by
+## medconv, once as rolling_median would write it and once with all
+## columns, see src/binout.h
+cd ./src/
+make > /dev/null && make medconv > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median --format bin:edges,nodes ./venmo_input/venmo-trans.txt ./venmo_output/output.bin
+  ./src/medconv ./venmo_output/output.bin ./venmo_output/medians.txt
+  ./src/medconv -c ./venmo_output/output.bin ./venmo_output/columns.txt
+  cat ./venmo_output/medians.txt ./venmo_output/columns.txt > ./venmo_output/output.txt
+fi
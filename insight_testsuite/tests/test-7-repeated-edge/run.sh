@@ -0,0 +1,14 @@
+#!/usr/bin/env bash
+
+## the only edge in the window repeated, so it is evicted and inserted
+## again, which must keep the maximum degree at 1, with the classic and
+## the static engine
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median ./venmo_input/venmo-trans.txt ./venmo_output/classic.txt
+  ./src/rolling_median --engine static ./venmo_input/venmo-trans.txt ./venmo_output/static.txt
+  cat ./venmo_output/classic.txt ./venmo_output/static.txt > ./venmo_output/output.txt
+fi
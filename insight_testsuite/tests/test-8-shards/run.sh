@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+
+## the graph spread over two and three worker processes, which must
+## write the same medians as the classic engine, see src/shard.h
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median --shards 2 ./venmo_input/venmo-trans.txt ./venmo_output/two.txt
+  ./src/rolling_median --shards 3 ./venmo_input/venmo-trans.txt ./venmo_output/three.txt
+  cat ./venmo_output/two.txt ./venmo_output/three.txt > ./venmo_output/output.txt
+fi
@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+
+## records with further fields in any order, strings holding braces and
+## quotes, nested objects and arrays, parsed with --wide
+cd ./src/
+make > /dev/null
+cd ..
+
+if [ $? -eq 0 ] ; then
+  ./src/rolling_median --wide ./venmo_input/venmo-trans.txt ./venmo_output/output.txt
+fi
@@ -0,0 +1,158 @@
+#!/bin/bash
+## Performance regression suite for rolling_median, run by "make bench"
+## from the src directory. Generates a fixed set of workloads, runs the
+## binary several times on each, alternating with a reference binary
+## built from another revision, and compares the median throughput and
+## p99 latency of the two. Both run on the same host in the same
+## invocation, so the gate measures the change, not the host. Output
+## checksums are compared against a baseline file, so a change that is
+## fast but wrong fails as well.
+
+declare -r color_start="\033["
+declare -r color_red="${color_start}0;31m"
+declare -r color_green="${color_start}0;32m"
+declare -r color_norm="${color_start}0m"
+
+function abort {
+  echo "usage: $0 [-w] [-b <binary>] [-t <percent>] [-r <runs>] [-d <workdir>] [-f <flags>] <baseline>"
+  echo "  -w  write output checksums as new baseline instead of comparing"
+  echo "  -b  reference binary to compare speed with, without it speed is"
+  echo "      only reported"
+  echo "  -t  tolerated slowdown against the reference in percent (10)"
+  echo "  -r  runs per workload, medians are compared (5)"
+  echo "  -d  directory for generated workloads (/tmp/rolling_median_bench)"
+  echo "  -f  extra rolling_median flags, e.g. \"--engine static\""
+  exit 1
+}
+
+TOLERANCE=10
+RUNS=5
+WORKDIR=/tmp/rolling_median_bench
+WRITE=0
+FLAGS=""
+REFERENCE=""
+while getopts "wb:t:r:d:f:" opt; do
+  case $opt in
+    w) WRITE=1 ;;
+    b) REFERENCE=$OPTARG ;;
+    t) TOLERANCE=$OPTARG ;;
+    r) RUNS=$OPTARG ;;
+    d) WORKDIR=$OPTARG ;;
+    f) FLAGS=$OPTARG ;;
+    *) abort ;;
+  esac
+done
+shift $((OPTIND - 1))
+BASELINE=$1
+if [ "x$BASELINE" = "x" ]; then
+  abort
+fi
+
+SRCDIR=$(cd $(dirname ${BASH_SOURCE})/../src && pwd)
+BINARY=${SRCDIR}/rolling_median
+GENERATOR=${SRCDIR}/venmogen
+
+## workload name and venmogen options, fixed seeds keep them reproducible
+WORKLOADS=(
+  "steady    -n 100000 -u 1000 -r 100 -s 1"
+  "disorder  -n 100000 -u 2000 -r 100 -d 30 -s 2"
+  "hubs      -n 100000 -u 20000 -r 300 -H 0.3 -k 5 -s 3"
+  "sparse    -n 20000 -u 1000 -r 0.02 -s 4"
+)
+
+## median of numbers given as arguments
+function median {
+  printf "%s\n" "$@" | sort -g | awk '{v[NR]=$1} END{print v[int((NR+1)/2)]}'
+}
+
+## run binary $1 once on workload ${input}, appending throughput and
+## p99 to the arrays named $2 and $3 and setting runsum to the output
+## checksum
+function measure {
+  local output=${WORKDIR}/${name}_output.txt
+  local stats
+  stats=$($1 --stats ${FLAGS} ${input} ${output} 2>&1 >/dev/null) || exit 1
+  eval "$2+=($(echo "$stats" | awk '$1=="records"{print $6}'))"
+  eval "$3+=($(echo "$stats" | awk '$1=="latency_us"{print $5}'))"
+  runsum=$(md5sum < ${output} | cut -d' ' -f1)
+}
+
+mkdir -p ${WORKDIR}
+FAILED=0
+NEWBASE=""
+for workload in "${WORKLOADS[@]}"; do
+  set -- $workload
+  name=$1
+  shift
+  input=${WORKDIR}/${name}.txt
+  ${GENERATOR} "$@" ${input} || exit 1
+
+  throughputs=()
+  latencies=()
+  refthroughputs=()
+  reflatencies=()
+  checksum=""
+  for run in $(seq 1 ${RUNS}); do
+    if [ "x${REFERENCE}" != "x" ]; then
+      measure ${REFERENCE} refthroughputs reflatencies
+    fi
+    measure ${BINARY} throughputs latencies
+    if [ "x$checksum" != "x" ] && [ "$checksum" != "$runsum" ]; then
+      echo -e "[${color_red}FAIL${color_norm}]: ${name} output differs between runs"
+      FAILED=1
+    fi
+    checksum=$runsum
+  done
+  throughput=$(median "${throughputs[@]}")
+  p99=$(median "${latencies[@]}")
+  NEWBASE="${NEWBASE}${name} ${checksum}\n"
+
+  if [ ${WRITE} -eq 1 ]; then
+    printf "%-10s %12.0f records/s  p99 %8.3f us\n" ${name} ${throughput} ${p99}
+    continue
+  fi
+
+  base=$(awk -v n=${name} '$1==n' ${BASELINE})
+  if [ "x$base" = "x" ]; then
+    echo -e "[${color_red}FAIL${color_norm}]: ${name} has no baseline entry"
+    FAILED=1
+    continue
+  fi
+  set -- $base
+  if [ "$checksum" != "$2" ]; then
+    echo -e "[${color_red}FAIL${color_norm}]: ${name} output does not match baseline checksum"
+    FAILED=1
+    continue
+  fi
+  if [ "x${REFERENCE}" = "x" ]; then
+    printf -v summary "%.0f records/s, p99 %.3f us" ${throughput} ${p99}
+    echo -e "[${color_green}PASS${color_norm}]: ${name} ${summary}"
+    continue
+  fi
+  reft=$(median "${refthroughputs[@]}")
+  refl=$(median "${reflatencies[@]}")
+  verdict=$(awk -v t=${throughput} -v l=${p99} -v bt=${reft} -v bl=${refl} -v tol=${TOLERANCE} \
+    'BEGIN{
+      msg = "";
+      if( t < bt * (1 - tol/100) ) msg = msg sprintf(" throughput %.1f%% below reference", 100*(1-t/bt));
+      if( l > bl * (1 + tol/100) ) msg = msg sprintf(" p99 %.1f%% above reference", 100*(l/bl-1));
+      print msg }')
+  printf -v summary "%.0f records/s (reference %.0f), p99 %.3f us (reference %.3f)" \
+    ${throughput} ${reft} ${p99} ${refl}
+  if [ "x$verdict" != "x" ]; then
+    echo -e "[${color_red}FAIL${color_norm}]: ${name}${verdict}: ${summary}"
+    FAILED=1
+  else
+    echo -e "[${color_green}PASS${color_norm}]: ${name} ${summary}"
+  fi
+done
+
+if [ ${WRITE} -eq 1 ]; then
+  {
+    echo "## rolling_median benchmark output checksums, written by 'make bench-baseline'"
+    echo "## workload output-md5sum"
+    printf "${NEWBASE}"
+  } > ${BASELINE}
+  echo "Baseline written to ${BASELINE}"
+fi
+exit ${FAILED}
@@ -0,0 +1,69 @@
+#!/usr/bin/env bash
+
+## Smoke test of the bpftrace scripts in this directory, run by
+## "make probes-test" from the src directory. Runs each script on a small
+## generated input and checks that every map it fills shows up, so the
+## probes fire and the scripts still match their names and arguments.
+## Skips, with exit status 0, when bpftrace, root or the probes are not
+## available, see probes.h.
+
+BPFDIR=$(dirname $0)
+BINARY=./rolling_median
+GENERATOR=./venmogen
+WORKDIR=${TMPDIR:-/tmp}/rolling_median_probes
+
+color_red="\e[1;31m"
+color_green="\e[0;32m"
+color_yellow="\e[0;33m"
+color_norm="\e[0m"
+
+function skip {
+  echo -e "[${color_yellow}SKIP${color_norm}]: $1"
+  exit 0
+}
+
+type bpftrace > /dev/null 2>&1 || skip "bpftrace not found"
+[ $(id -u) -eq 0 ] || skip "bpftrace needs root"
+readelf -n ${BINARY} 2>/dev/null | grep -q stapsdt \
+  || skip "${BINARY} built without probes, sys/sdt.h was not found"
+
+mkdir -p ${WORKDIR}
+input=${WORKDIR}/input.txt
+${GENERATOR} -n 20000 -u 500 -r 20 -d 5 -s 46 ${input} || exit 1
+# a record a day later, which drops the whole window, and two lines
+# that are rejected
+echo '{"created_time": "2016-04-08T03:33:19Z", "target": "B", "actor": "A"}' >> ${input}
+echo '{"created_time": "2016-04-08T03:33:19Z", "actor": "A"}' >> ${input}
+echo '{"created_time": "2016-04-08T03:33:19Z", "target": "B"' >> ${input}
+
+# script and the maps it must print
+CHECKS=(
+  "latency.bt @record_us @refreshed"
+  "evictions.bt @second_edges @window_edges"
+  "rejects.bt @parsed @rejected"
+)
+
+FAILED=0
+for check in "${CHECKS[@]}"; do
+  set -- $check
+  script=$1
+  shift
+  output=${WORKDIR}/${script%.bt}.out
+  if ! bpftrace -c "${BINARY} ${input} ${WORKDIR}/output.txt" \
+       ${BPFDIR}/${script} > ${output} 2>&1; then
+    echo -e "[${color_red}FAIL${color_norm}]: ${script} did not run, see ${output}"
+    FAILED=1
+    continue
+  fi
+  missing=""
+  for map in "$@"; do
+    grep -q "^${map}" ${output} || missing="${missing} ${map}"
+  done
+  if [ "x$missing" != "x" ]; then
+    echo -e "[${color_red}FAIL${color_norm}]: ${script} printed no${missing}, see ${output}"
+    FAILED=1
+  else
+    echo -e "[${color_green}PASS${color_norm}]: ${script}"
+  fi
+done
+exit ${FAILED}
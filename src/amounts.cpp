@@ -0,0 +1,211 @@
+#include <string>
+#include <vector>
+#include <cmath>         // std::floor, llround
+#include <cstdlib>       // strtod
+#include "amounts.h"
+
+
+OrderStat::OrderStat(): level(1), count(0), links(0),
+  state(0x9E3779B97F4A7C15ULL) {
+  head.value = 0;
+  head.height = SKIPLEVELS;
+  head.links = new Link[SKIPLEVELS];
+  head.links[0].next = NULL;
+  head.links[0].width = 1;
+}
+
+OrderStat::~OrderStat() {
+  clear();
+  delete [] head.links;
+}
+
+// Height h with probability 2^-h, from the trailing ones of xorshift64
+uint OrderStat::randomHeight() {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  uint height = 1;
+  for(unsigned long long bits = state; (bits & 1) && height < SKIPLEVELS;
+      bits >>= 1) {
+    height++;
+  }
+  return height;
+}
+
+// Insert after all equal values. update[l] is the last item before the
+// new one on level l, at position rank[l], head at position 0.
+void OrderStat::insert(long long value) {
+  Item* update[SKIPLEVELS];
+  std::size_t rank[SKIPLEVELS];
+  Item* item = &head;
+  std::size_t pos = 0;
+  for(int ll = level - 1; ll >= 0; ll--) {
+    while( NULL != item->links[ll].next
+           && item->links[ll].next->value <= value ) {
+      pos += item->links[ll].width;
+      item = item->links[ll].next;
+    }
+    update[ll] = item;
+    rank[ll] = pos;
+  }
+  uint height = randomHeight();
+  for(; level < height; level++) {
+    head.links[level].next = NULL;
+    head.links[level].width = count + 1;
+    update[level] = &head;
+    rank[level] = 0;
+  }
+  Item* newitem = new Item;
+  newitem->value = value;
+  newitem->height = height;
+  newitem->links = new Link[height];
+  std::size_t newpos = pos + 1;
+  for(uint ll = 0; ll < height; ll++) {
+    Link& prev = update[ll]->links[ll];
+    newitem->links[ll].next = prev.next;
+    newitem->links[ll].width = rank[ll] + prev.width + 1 - newpos;
+    prev.next = newitem;
+    prev.width = newpos - rank[ll];
+  }
+  for(uint ll = height; ll < level; ll++) {
+    update[ll]->links[ll].width++;
+  }
+  count++;
+  links += height;
+}
+
+// Remove the first item of value, update[l] is the last item before it
+// on level l
+bool OrderStat::erase(long long value) {
+  Item* update[SKIPLEVELS];
+  Item* item = &head;
+  for(int ll = level - 1; ll >= 0; ll--) {
+    while( NULL != item->links[ll].next
+           && item->links[ll].next->value < value ) {
+      item = item->links[ll].next;
+    }
+    update[ll] = item;
+  }
+  item = item->links[0].next;
+  if( NULL == item || value != item->value ) {
+    return false;
+  }
+  for(uint ll = 0; ll < level; ll++) {
+    Link& prev = update[ll]->links[ll];
+    if( item == prev.next ) {
+      prev.width += item->links[ll].width - 1;
+      prev.next = item->links[ll].next;
+    } else {
+      prev.width--;
+    }
+  }
+  // levels above the tallest remaining item are reset when they regrow
+  while( level > 1 && NULL == head.links[level - 1].next ) {
+    level--;
+  }
+  count--;
+  links -= item->height;
+  delete [] item->links;
+  delete item;
+  return true;
+}
+
+long long OrderStat::at(std::size_t rank) const {
+  const Item* item = &head;
+  std::size_t pos = 0;
+  for(int ll = level - 1; ll >= 0; ll--) {
+    while( NULL != item->links[ll].next
+           && pos + item->links[ll].width <= rank + 1 ) {
+      pos += item->links[ll].width;
+      item = item->links[ll].next;
+    }
+  }
+  return item->value;
+}
+
+void OrderStat::clear() {
+  Item* item = head.links[0].next;
+  while( NULL != item ) {
+    Item* next = item->links[0].next;
+    delete [] item->links;
+    delete item;
+    item = next;
+  }
+  level = 1;
+  count = 0;
+  links = 0;
+  head.links[0].next = NULL;
+  head.links[0].width = 1;
+}
+
+std::size_t OrderStat::bytes() const {
+  return (SKIPLEVELS + links) * sizeof(Link) + count * sizeof(Item);
+}
+
+void AmountWindow::add(uint sec, long long cents) {
+  secs[sec].push_back(cents);
+  stat.insert(cents);
+}
+
+void AmountWindow::evictSecond(uint sec) {
+  std::vector<long long>& bucket = secs[sec];
+  for(std::size_t ii = 0; ii < bucket.size(); ii++) {
+    stat.erase(bucket[ii]);
+  }
+  bucket.clear();
+}
+
+void AmountWindow::clear() {
+  for(uint sec = 0; sec < MAXSEC; sec++) {
+    secs[sec].clear();
+  }
+  stat.clear();
+}
+
+long long AmountWindow::quantile(double q) const {
+  if( 0 == stat.size() ) {
+    return 0;
+  }
+  double pos = q * (stat.size() - 1);
+  std::size_t lower = std::floor(pos);
+  long long value = stat.at(lower);
+  if( lower + 1 < stat.size() && pos > lower ) {
+    return llround(value + (stat.at(lower + 1) - value) * (pos - lower));
+  }
+  return value;
+}
+
+std::size_t AmountWindow::bytes() const {
+  std::size_t bytes = stat.bytes();
+  for(uint sec = 0; sec < MAXSEC; sec++) {
+    bytes += secs[sec].capacity() * sizeof(long long);
+  }
+  return bytes;
+}
+
+std::string AmountWindow::format(long long cents) {
+  std::string str = std::to_string(cents / 100) + ".";
+  str += '0' + (cents % 100) / 10;
+  str += '0' + cents % 10;
+  return str;
+}
+
+bool AmountWindow::parseQuantiles(const char* spec,
+                                  std::vector<double>& qs) {
+  const char* pos = spec;
+  while( true ) {
+    char* end;
+    double q = strtod(pos, &end);
+    if( end == pos || !(q >= 0.0 && q <= 1.0) ) {
+      return false;
+    }
+    qs.push_back(q);
+    if( '\0' == *end ) {
+      return true;
+    }
+    if( ',' != *end ) {
+      return false;
+    }
+    pos = end + 1;
+  }
+}
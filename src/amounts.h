@@ -0,0 +1,79 @@
+#ifndef AMOUNTS_H
+#define AMOUNTS_H
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "epochtime.h"
+
+// For convenience
+typedef unsigned int uint;
+
+// Levels of OrderStat, enough for 2^32 values
+#define SKIPLEVELS 32
+
+// Multiset of integers with access by rank: an indexable skip list.
+// Every link also stores its width, how many positions it advances, so
+// the search for rank k sums widths on the way down instead of counting
+// items. Insert, erase and rank access are O(log n) expected.
+class OrderStat {
+protected:
+  struct Item;
+  struct Link {
+    Item* next;
+    std::size_t width;
+  };
+  struct Item {
+    long long value;
+    uint height;
+    Link* links;
+  };
+  // head item of SKIPLEVELS links, the end is position count + 1
+  Item head;
+  uint level;
+  std::size_t count, links;
+  // xorshift state for the item heights
+  unsigned long long state;
+  uint randomHeight();
+
+public:
+  OrderStat();
+  ~OrderStat();
+  void insert(long long value);
+  // Remove one copy of value, false if there is none
+  bool erase(long long value);
+  // Value of rank rank from 0 for the smallest, rank < size()
+  long long at(std::size_t rank) const;
+  std::size_t size() const { return count; }
+  void clear();
+  // Bytes of items and links
+  std::size_t bytes() const;
+};
+
+// Transaction amounts in the window of Graph, in cents, for quantiles.
+// Amounts sit in one bucket per second of the same cyclic ring as the
+// edge tables, and are evicted with them, so the window is kept only
+// once, as edges and their amounts.
+class AmountWindow {
+protected:
+  OrderStat stat;
+  std::vector<long long> secs[MAXSEC];
+
+public:
+  // Amount of a record at second sec
+  void add(uint sec, long long cents);
+  // Second sec leaves the window
+  void evictSecond(uint sec);
+  void clear();
+  std::size_t size() const { return stat.size(); }
+  // q quantile, interpolated between the two nearest ranks as with
+  // (n - 1) q, rounded to the cent, 0 for no amounts
+  long long quantile(double q) const;
+  std::size_t bytes() const;
+
+  // "D.CC" dollars of cents
+  static std::string format(long long cents);
+  // Parse a comma separated list of quantiles in [0, 1], e.g. "0.5,0.9"
+  static bool parseQuantiles(const char* spec, std::vector<double>& qs);
+};
+
+#endif
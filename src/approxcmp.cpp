@@ -0,0 +1,172 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>      // strtoul, strtod
+#include <cstdio>       // remove
+#include <getopt.h>
+#include <unistd.h>     // mkstemp, close
+#include "venmodata.h"
+#include "venmoio.h"
+#include "streamgen.h"
+#include "multigraph.h"
+#include "approxgraph.h"
+#include "stringutils.h"
+
+
+// Measures the error of the approximate engine against an exact window
+// layer record by record, on a generated stream or an input file
+
+// Exact reference, WindowLayer with access to its degree histogram
+class ExactLayer : public WindowLayer {
+public:
+  ExactLayer(NameStore* store, uint window): WindowLayer(store, window) {};
+  // Fractions of nodes with twice the degree below and up to med2
+  void rank(uint med2, double& below, double& upto) const {
+    unsigned long long sum = 0, less = 0, lesseq = 0;
+    for(uint ii = 0; ii <= maxdeg; ii++) {
+      sum += degrees[ii];
+      if( 2*ii < med2 ) {
+        less += degrees[ii];
+      }
+      if( 2*ii <= med2 ) {
+        lesseq += degrees[ii];
+      }
+    }
+    below = sum ? (double)less / sum : 0.0;
+    upto = sum ? (double)lesseq / sum : 1.0;
+  };
+};
+
+void usage(const char* prog) {
+  stu::abortf("usage: %s [options]\n"
+    "  -w <seconds>   window length (60)\n"
+    "  -b <entries>   budget of the approximate engine (65536)\n"
+    "  -i <file>      compare on this input instead of a generated stream\n"
+    "  stream options as for venmogen:\n"
+    "  -n <records>   number of records (100000)\n"
+    "  -u <users>     number of distinct users (10000)\n"
+    "  -r <rate>      mean records per second (50)\n"
+    "  -d <seconds>   maximum lag of out of order records (0)\n"
+    "  -H <fraction>  fraction of records sent by hubs (0)\n"
+    "  -k <hubs>      number of hub users (10)\n"
+    "  -s <seed>      random seed (1)\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+  streamspec spec;
+  uint window = MAXSEC;
+  std::size_t budget = 1 << 16;
+  const char* infname = NULL;
+  int opt;
+  while( -1 != (opt = getopt(argc, argv, "w:b:i:n:u:r:d:H:k:s:")) ) {
+    switch( opt ) {
+      case 'w': window = strtoul(optarg, NULL, 10); break;
+      case 'b': budget = strtoul(optarg, NULL, 10); break;
+      case 'i': infname = optarg; break;
+      case 'n': spec.nrec = strtoul(optarg, NULL, 10); break;
+      case 'u': spec.nusers = strtoul(optarg, NULL, 10); break;
+      case 'r': spec.rate = strtod(optarg, NULL); break;
+      case 'd': spec.disorder = strtoul(optarg, NULL, 10); break;
+      case 'H': spec.hubfrac = strtod(optarg, NULL); break;
+      case 'k': spec.nhubs = strtoul(optarg, NULL, 10); break;
+      case 's': spec.seed = strtoul(optarg, NULL, 10); break;
+      default: usage(argv[0]);
+    }
+  }
+  if( argc != optind || 0 == window || budget < 16 || spec.nusers < 2
+      || spec.rate <= 0.0 || 0 == spec.nhubs || spec.nhubs > spec.nusers ) {
+    usage(argv[0]);
+  }
+
+  // the parser reads files, so a generated stream goes through one
+  char tmpname[] = "/tmp/approxcmpXXXXXX";
+  if( NULL == infname ) {
+    int fd = mkstemp(tmpname);
+    if( fd < 0 ) {
+      stu::abortf("Cannot create temporary file\n");
+    }
+    close(fd);
+    std::ofstream tmpfile(tmpname);
+    streamgen gen(spec);
+    std::string line;
+    while( gen.next(line) ) {
+      tmpfile << line << '\n';
+    }
+    infname = tmpname;
+  }
+  venmoio vio;
+  if( ! vio.openInput(infname) ) {
+    stu::abortf("Cannot read %s\n", infname);
+  }
+
+  ApproxGraph approx(&vio, window, budget);
+  NameStore store;
+  ExactLayer exact(&store, window);
+  venmodata vdt("", "", "");
+  unsigned long long records = 0, exactmed = 0, exceeded = 0;
+  double abssum = 0.0, absmax = 0.0, ranksum = 0.0, rankmax = 0.0;
+  double boundsum = 0.0, boundmax = 0.0;
+  while( vio.parseLine(&vdt) ) {
+    if( vdt.FlagAll != vdt.supplied ) {
+      continue;
+    }
+    approx.process(&vdt);
+    // pin both nodes across the layer update as MultiGraph::process does
+    uint actor = store.findOrAdd(vdt.actor);
+    uint target = store.findOrAdd(vdt.target);
+    store.liveCount(actor)++;
+    if( actor != target ) {
+      store.liveCount(target)++;
+    }
+    exact.process(actor, target, vdt.epochtime);
+    if( 0 == --store.liveCount(actor) ) {
+      store.release(actor);
+    }
+    if( actor != target && 0 == --store.liveCount(target) ) {
+      store.release(target);
+    }
+
+    uint amed2 = approx.median2();
+    uint emed2 = exact.median2();
+    double abserr = (amed2 > emed2 ? amed2 - emed2 : emed2 - amed2) / 2.0;
+    double below, upto;
+    exact.rank(amed2, below, upto);
+    double rankerr = 0.0;
+    if( below > 0.5 ) {
+      rankerr = below - 0.5;
+    } else if( upto < 0.5 ) {
+      rankerr = 0.5 - upto;
+    }
+    double bound = approx.rankError(0.01);
+    records++;
+    exactmed += (amed2 == emed2);
+    exceeded += (rankerr > bound);
+    abssum += abserr;
+    absmax = abserr > absmax ? abserr : absmax;
+    ranksum += rankerr;
+    rankmax = rankerr > rankmax ? rankerr : rankmax;
+    boundsum += bound;
+    boundmax = bound > boundmax ? bound : boundmax;
+  }
+  if( tmpname == infname ) {
+    remove(tmpname);
+  }
+  if( 0 == records ) {
+    stu::abortf("No valid records\n");
+  }
+
+  std::cout << "records " << records << " window " << window
+    << " budget " << budget << std::endl
+    << "final level " << approx.getLevel() << " (1 in "
+    << (1ULL << approx.getLevel()) << " nodes), tracked nodes "
+    << approx.trackedNodes() << " of " << store.size() << std::endl
+    << "median exact for " << 100.0 * exactmed / records
+    << "% of records, abs error mean " << abssum / records
+    << " max " << absmax << std::endl
+    << "rank error mean " << ranksum / records << " max " << rankmax
+    << std::endl
+    << "rank error bound (99%) mean " << boundsum / records << " max "
+    << boundmax << ", exceeded for " << 100.0 * exceeded / records
+    << "% of records" << std::endl;
+  return 0;
+}
@@ -0,0 +1,282 @@
+#include <string>
+#include <vector>
+#include <cmath>         // sqrt, log
+#include <cassert>       // assert
+#include <climits>       // UINT_MAX
+#include "stringutils.h"
+#include "epochtime.h"
+#include "hashtable.h"
+#include "venmodata.h"
+#include "venmoio.h"
+#include "emitter.h"
+#include "multigraph.h"
+#include "approxgraph.h"
+
+
+// SipHash under the process key of hashtable, so the sample, the nodes
+// whose top bits are zero, cannot be chosen by whoever writes the input
+unsigned long long ApproxGraph::fingerprint(const std::string& name) {
+  return htb::siphash(name.data(), name.length());
+}
+
+ApproxGraph::ApproxGraph(venmoio* vio, uint window, std::size_t budget):
+  vio(vio), window(window), level(0), budget(budget), nstamps(0),
+  currtime(-(time_t)window), ring(window), maxdeg(1), degsize(2048),
+  worstn(~(std::size_t)0), emit(vio) {
+  degrees = new uint[degsize]();
+}
+
+ApproxGraph::~ApproxGraph() {
+  delete [] degrees;
+}
+
+void ApproxGraph::setWindow(uint mywindow) {
+  evictAll();
+  window = mywindow;
+  currtime = -(time_t)window;
+  ring.assign(window, std::vector<EdgeStamp>());
+}
+
+void ApproxGraph::setBudget(std::size_t mybudget) {
+  budget = mybudget;
+}
+
+inline bool ApproxGraph::tracked(unsigned long long fp) const {
+  return 0 == level || 0 == (fp >> (64 - level));
+}
+
+void ApproxGraph::incDeg(unsigned long long fp) {
+  uint mydeg = nodes[fp]++;
+  if( mydeg > 0 ) {
+    degrees[mydeg]--;
+  }
+  degrees[mydeg + 1]++;
+  if( mydeg + 1 > maxdeg ) {
+    maxdeg = mydeg + 1;
+    // grow occupation array by doubling as Graph::incMaxdeg
+    if( maxdeg + 1 >= degsize ) {
+      if( maxdeg >= (UINT_MAX >> 1) ) {
+        stu::abortf("Detected extremely high node degree, aborting.\n");
+      }
+      uint* temp = new uint[degsize << 1]();
+      for(uint ii = 0; ii <= maxdeg; ii++) {
+        temp[ii] = degrees[ii];
+      }
+      delete [] degrees;
+      degrees = temp;
+      degsize <<= 1;
+    }
+  }
+}
+
+void ApproxGraph::decDeg(unsigned long long fp) {
+  std::unordered_map<unsigned long long, uint>::iterator it = nodes.find(fp);
+  assert( nodes.end() != it );
+  uint mydeg = it->second--;
+  degrees[mydeg]--;
+  if( mydeg == maxdeg && 0 == degrees[mydeg] && maxdeg > 1 ) {
+    maxdeg--;
+  }
+  if( 1 == mydeg ) {
+    nodes.erase(it);
+  } else {
+    degrees[mydeg - 1]++;
+  }
+}
+
+// As WindowLayer::evictSlot, but only ends still tracked have degrees
+void ApproxGraph::evictSlot(uint slot) {
+  std::vector<EdgeStamp>& stamps = ring[slot];
+  for(std::size_t ii = 0; ii < stamps.size(); ii++) {
+    std::unordered_map<unsigned long long, ApproxEdge>::iterator it =
+      edges.find(stamps[ii].key);
+    if( edges.end() != it && it->second.time == stamps[ii].time ) {
+      for(int jj = 0; jj < 2; jj++) {
+        if( tracked(it->second.ends[jj]) ) {
+          decDeg(it->second.ends[jj]);
+        }
+      }
+      edges.erase(it);
+    }
+  }
+  nstamps -= stamps.size();
+  std::vector<EdgeStamp>().swap(stamps);
+}
+
+// Empty window, which also allows tracking every node again
+void ApproxGraph::evictAll() {
+  nodes.clear();
+  edges.clear();
+  for(uint slot = 0; slot < ring.size(); slot++) {
+    std::vector<EdgeStamp>().swap(ring[slot]);
+  }
+  nstamps = 0;
+  for(uint ii = 0; ii <= maxdeg; ii++) {
+    degrees[ii] = 0;
+  }
+  maxdeg = 1;
+  level = 0;
+}
+
+// Drop ring entries of edges that were refreshed or purged since
+void ApproxGraph::compactRing() {
+  nstamps = 0;
+  for(uint slot = 0; slot < ring.size(); slot++) {
+    std::vector<EdgeStamp>& stamps = ring[slot];
+    std::size_t kept = 0;
+    for(std::size_t ii = 0; ii < stamps.size(); ii++) {
+      std::unordered_map<unsigned long long, ApproxEdge>::const_iterator it =
+        edges.find(stamps[ii].key);
+      if( edges.end() != it && it->second.time == stamps[ii].time ) {
+        stamps[kept++] = stamps[ii];
+      }
+    }
+    stamps.resize(kept);
+    nstamps += kept;
+  }
+}
+
+// Forget nodes no longer tracked at the current level, and edges
+// without a tracked end
+void ApproxGraph::purge() {
+  std::unordered_map<unsigned long long, uint>::iterator nit = nodes.begin();
+  while( nodes.end() != nit ) {
+    if( tracked(nit->first) ) {
+      ++nit;
+    } else {
+      degrees[nit->second]--;
+      nit = nodes.erase(nit);
+    }
+  }
+  while( maxdeg > 1 && 0 == degrees[maxdeg] ) {
+    maxdeg--;
+  }
+  std::unordered_map<unsigned long long, ApproxEdge>::iterator eit =
+    edges.begin();
+  while( edges.end() != eit ) {
+    if( tracked(eit->second.ends[0]) || tracked(eit->second.ends[1]) ) {
+      ++eit;
+    } else {
+      eit = edges.erase(eit);
+    }
+  }
+}
+
+// Get back below three quarters of the budget, first by dropping stale
+// ring entries, then by halving the node sample as often as needed.
+// The slack makes sure shrinking happens rarely.
+void ApproxGraph::shrink() {
+  std::size_t target = budget - budget / 4;
+  compactRing();
+  while( nodes.size() + edges.size() + nstamps > target && level < 63 ) {
+    level++;
+    purge();
+    compactRing();
+  }
+}
+
+// Same decisions as Graph::process and WindowLayer::process, for the
+// edges that have a tracked end
+void ApproxGraph::process(venmodata* vdt) {
+  time_t timediff = vdt->epochtime - currtime;
+  if( timediff <= -(time_t)window ) {
+    return;
+  }
+  if( timediff > 0 ) {
+    if( timediff >= (time_t)window ) {
+      evictAll();
+    } else {
+      for(time_t mytime = currtime + 1; mytime <= vdt->epochtime; mytime++) {
+        evictSlot(mytime % window);
+      }
+    }
+    currtime = vdt->epochtime;
+  }
+  ApproxEdge edge = {vdt->epochtime,
+    {fingerprint(vdt->actor), fingerprint(vdt->target)}};
+  if( ! tracked(edge.ends[0]) && ! tracked(edge.ends[1]) ) {
+    return;
+  }
+  unsigned long long key = edge.ends[0] ^ (edge.ends[1] * 0x9E3779B97F4A7C15ULL);
+  std::pair<std::unordered_map<unsigned long long, ApproxEdge>::iterator, bool>
+    res = edges.insert(std::make_pair(key, edge));
+  if( res.second ) {
+    for(int jj = 0; jj < 2; jj++) {
+      if( tracked(edge.ends[jj]) ) {
+        incDeg(edge.ends[jj]);
+      }
+    }
+  } else if( res.first->second.time != vdt->epochtime ) {
+    res.first->second.time = vdt->epochtime;
+  } else {
+    return;
+  }
+  EdgeStamp stamp = {key, vdt->epochtime};
+  ring[vdt->epochtime % window].push_back(stamp);
+  nstamps++;
+  if( nodes.size() + edges.size() + nstamps > budget ) {
+    shrink();
+  }
+}
+
+uint ApproxGraph::median2() const {
+  assert( 0 == degrees[0] );
+  uint ii;
+  unsigned long long int sum = 0;
+  for(ii = 0; ii <= maxdeg; ii++) {
+    sum += degrees[ii];
+  }
+  unsigned long long int sum2 = 0;
+  for(ii = 0; ii <= maxdeg; ii++) {
+    sum2 += 2*degrees[ii];
+    if( sum2 >= sum ) {
+      break;
+    }
+  }
+  return 2*ii + ((sum2 > sum) ? 0 : 1);
+}
+
+void ApproxGraph::output() {
+  if( emit.due(currtime) ) {
+    if( level > 0 && nodes.size() < worstn ) {
+      worstn = nodes.size();
+    }
+    emit.put(median2());
+  }
+}
+
+void ApproxGraph::setOutputMode(int mode, unsigned long every) {
+  emit.setMode(mode, every);
+}
+
+void ApproxGraph::resumeOutput(const emitter& other) {
+  emit.resume(other);
+}
+
+void ApproxGraph::finishOutput() {
+  emit.finish();
+}
+
+uint ApproxGraph::getLevel() const {
+  return level;
+}
+
+std::size_t ApproxGraph::trackedNodes() const {
+  return nodes.size();
+}
+
+static double dkwBound(std::size_t n, double delta) {
+  if( 0 == n ) {
+    return 0.5;
+  }
+  double eps = sqrt(log(2.0 / delta) / (2.0 * n));
+  return eps < 0.5 ? eps : 0.5;
+}
+
+double ApproxGraph::rankError(double delta) const {
+  return 0 == level ? 0.0 : dkwBound(nodes.size(), delta);
+}
+
+double ApproxGraph::worstRankError(double delta) const {
+  return ~(std::size_t)0 == worstn ? 0.0 : dkwBound(worstn, delta);
+}
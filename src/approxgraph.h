@@ -0,0 +1,95 @@
+#ifndef APPROXGRAPH_H
+#define APPROXGRAPH_H
+#include <vector>
+#include <unordered_map>
+#include <time.h>       // time_t
+#include "epochtime.h"
+#include "venmodata.h"
+#include "venmoio.h"
+#include "emitter.h"
+#include "multigraph.h"
+
+// For convenience
+typedef unsigned int uint;
+
+// Edge of ApproxGraph: time of latest transaction and fingerprints of
+// both end nodes, so that evictions can find the nodes' degrees
+struct ApproxEdge {
+  time_t time;
+  unsigned long long ends[2];
+};
+
+// Bounded memory engine for long windows and huge numbers of nodes.
+//
+// Nodes are sampled by hash: a node is tracked iff the top level bits
+// of the 64 bit fingerprint of its name are zero, i.e. one in 2^level
+// nodes. Tracked nodes get their exact degree, as every edge with at
+// least one tracked end is kept, deduplicated by a 64 bit fingerprint
+// of the name pair instead of the names. Nodes and edges are never
+// stored by name. Whenever nodes, edges and ring entries together
+// exceed the budget, level goes up by one, which drops about half of
+// the tracked nodes and the edges no tracked node needs any more.
+// Since a node tracked at some level was tracked at all lower levels
+// since it appeared, degrees of tracked nodes stay exact.
+//
+// Error bound: the tracked nodes are a uniform random sample of the
+// nodes in the window, so by the Dvoretzky-Kiefer-Wolfowitz inequality
+// the sample median has a rank within eps = sqrt(ln(2/delta) / (2 n))
+// of 1/2 in the exact degree distribution, with probability 1 - delta
+// for n tracked nodes. That is, the reported median lies between the
+// exact 0.5 - eps and 0.5 + eps quantiles of node degrees. At level 0
+// every node is tracked and the median is exact, up to fingerprint
+// collisions of probability about edges^2 / 2^64.
+class ApproxGraph {
+protected:
+  venmoio* vio;
+  uint window, level;
+  std::size_t budget, nstamps;
+  time_t currtime;
+  // degree of tracked nodes by fingerprint
+  std::unordered_map<unsigned long long, uint> nodes;
+  std::unordered_map<unsigned long long, ApproxEdge> edges;
+  std::vector< std::vector<EdgeStamp> > ring;
+  uint* degrees;
+  uint maxdeg, degsize;
+  // fewest tracked nodes behind any approximate median written so far,
+  // all ones while every median was exact
+  std::size_t worstn;
+  emitter emit;
+  bool tracked(unsigned long long fp) const;
+  void incDeg(unsigned long long fp);
+  void decDeg(unsigned long long fp);
+  void evictSlot(uint slot);
+  void evictAll();
+  void compactRing();
+  void purge();
+  void shrink();
+
+public:
+  ApproxGraph(venmoio* vio, uint window = MAXSEC,
+              std::size_t budget = 1 << 22);
+  ~ApproxGraph();
+  // Window length in seconds, call before processing
+  void setWindow(uint mywindow);
+  // Maximum number of nodes, edges and ring entries held at a time
+  void setBudget(std::size_t mybudget);
+  void process(venmodata* vdt);
+  uint median2() const;
+  void output();
+  void setOutputMode(int mode, unsigned long every = 1);
+  // Continue the output of another engine, see emitter::resume
+  void resumeOutput(const emitter& other);
+  void finishOutput();
+  // One in 2^level nodes is tracked
+  uint getLevel() const;
+  std::size_t trackedNodes() const;
+  // Rank error bound of the current median at confidence 1 - delta
+  double rankError(double delta) const;
+  // Same for the worst of all medians written, 0 if all were exact
+  double worstRankError(double delta) const;
+
+  // 64 bit fingerprint of a name
+  static unsigned long long fingerprint(const std::string& name);
+};
+
+#endif
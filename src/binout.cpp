@@ -0,0 +1,228 @@
+#include <string>
+#include <vector>
+#include <cstring>       // strcmp, strncmp, strcspn, memcmp
+#include "stringutils.h"
+#include "venmoio.h"
+#include "binout.h"
+
+static const char* binmagic = "RMEDBIN1";
+static const char* colnames[BIN_NCOLS] =
+  {"record", "median2", "edges", "nodes", "epoch"};
+
+
+void binwriter::put32(unsigned int value) {
+  for(int ii = 0; ii < 4; ii++) {
+    buffer += (char)(value >> (8*ii));
+  }
+}
+
+void binwriter::put64(unsigned long long value) {
+  for(int ii = 0; ii < 8; ii++) {
+    buffer += (char)(value >> (8*ii));
+  }
+}
+
+void binwriter::writeHeader() {
+  buffer.assign(binmagic, 8);
+  put32(1);
+  put32(columns);
+  put32(BINBLOCK);
+  put32(mode);
+  put32(0);
+  put32(0);
+  vio->outBytes(buffer.data(), buffer.size());
+  started = true;
+}
+
+// Frame of reference encoding: per column the block minimum, and each
+// value as its offset from it in as few bytes as the largest one needs
+void binwriter::writeBlock() {
+  std::size_t rows = values[1].size();
+  if( 0 == rows ) {
+    return;
+  }
+  if( ! started ) {
+    writeHeader();
+  }
+  buffer.clear();
+  put32(rows);
+  for(int col = 0; col < BIN_NCOLS; col++) {
+    if( 0 == (columns & (1U << col)) ) {
+      continue;
+    }
+    std::vector<long long>& myvalues = values[col];
+    long long base = myvalues[0], top = myvalues[0];
+    for(std::size_t ii = 1; ii < rows; ii++) {
+      if( myvalues[ii] < base ) {
+        base = myvalues[ii];
+      }
+      if( myvalues[ii] > top ) {
+        top = myvalues[ii];
+      }
+    }
+    unsigned long long range = (unsigned long long)top - base;
+    int width = 8;
+    if( 0 == range ) {
+      width = 0;
+    } else if( range < 0x100ULL ) {
+      width = 1;
+    } else if( range < 0x10000ULL ) {
+      width = 2;
+    } else if( range < 0x100000000ULL ) {
+      width = 4;
+    }
+    buffer += (char)width;
+    put64(base);
+    for(std::size_t ii = 0; ii < rows; ii++) {
+      unsigned long long offset = (unsigned long long)myvalues[ii] - base;
+      for(int jj = 0; jj < width; jj++) {
+        buffer += (char)(offset >> (8*jj));
+      }
+    }
+    myvalues.clear();
+  }
+  vio->outBytes(buffer.data(), buffer.size());
+}
+
+void binwriter::setMode(unsigned int mymode) {
+  mode = mymode;
+}
+
+void binwriter::put(const binrow& row) {
+  for(int col = 0; col < BIN_NCOLS; col++) {
+    if( columns & (1U << col) ) {
+      values[col].push_back(row.values[col]);
+    }
+  }
+  if( values[1].size() >= BINBLOCK ) {
+    writeBlock();
+  }
+}
+
+void binwriter::finish() {
+  writeBlock();
+  started = false;
+}
+
+bool binwriter::parseFormat(const char* spec, unsigned int& mycolumns) {
+  if( 0 == strcmp(spec, "text") ) {
+    mycolumns = 0;
+    return true;
+  }
+  if( 0 != strncmp(spec, "bin", 3) ) {
+    return false;
+  }
+  mycolumns = BIN_MEDIAN;
+  spec += 3;
+  if( '\0' == *spec ) {
+    return true;
+  }
+  if( ':' != *spec ) {
+    return false;
+  }
+  do {
+    spec++;
+    std::size_t len = strcspn(spec, ",");
+    bool found = false;
+    // record and median2 come with the output mode, not by request
+    for(int col = 2; col < BIN_NCOLS; col++) {
+      if( strlen(colnames[col]) == len
+          && 0 == strncmp(spec, colnames[col], len) ) {
+        mycolumns |= 1U << col;
+        found = true;
+      }
+    }
+    if( ! found ) {
+      return false;
+    }
+    spec += len;
+  } while( ',' == *spec );
+  return true;
+}
+
+
+bool binreader::get32(unsigned int& value) {
+  unsigned char bytes[4];
+  if( ! in.read((char*)bytes, 4) ) {
+    return false;
+  }
+  value = 0;
+  for(int ii = 0; ii < 4; ii++) {
+    value |= (unsigned int)bytes[ii] << (8*ii);
+  }
+  return true;
+}
+
+bool binreader::get64(unsigned long long& value) {
+  unsigned char bytes[8];
+  if( ! in.read((char*)bytes, 8) ) {
+    return false;
+  }
+  value = 0;
+  for(int ii = 0; ii < 8; ii++) {
+    value |= (unsigned long long)bytes[ii] << (8*ii);
+  }
+  return true;
+}
+
+bool binreader::readHeader() {
+  char magic[8];
+  in.read(magic, 8);
+  if( 0 == in.gcount() ) {
+    return false;
+  }
+  unsigned int version, reserved;
+  if( 8 != in.gcount() || 0 != memcmp(magic, binmagic, 8)
+      || ! get32(version) || 1 != version || ! get32(columns)
+      || ! get32(blockrows) || ! get32(mode) || ! get32(reserved)
+      || ! get32(reserved) ) {
+    stu::abortf("Not a binary median file\n");
+  }
+  return true;
+}
+
+bool binreader::readBlock(std::vector<long long> values[BIN_NCOLS],
+                          unsigned int& rows) {
+  if( ! get32(rows) ) {
+    return false;
+  }
+  for(int col = 0; col < BIN_NCOLS; col++) {
+    values[col].clear();
+    if( 0 == (columns & (1U << col)) ) {
+      continue;
+    }
+    char width;
+    unsigned long long base;
+    if( ! in.get(width) || ! get64(base) ) {
+      stu::abortf("Truncated binary median file\n");
+    }
+    if( width < 0 || width > 8 || (width & (width - 1)) ) {
+      stu::abortf("Bad column width in binary median file\n");
+    }
+    std::vector<unsigned char> bytes((std::size_t)rows * width);
+    if( rows > 0 && width > 0 && ! in.read((char*)&bytes[0], bytes.size()) ) {
+      stu::abortf("Truncated binary median file\n");
+    }
+    values[col].resize(rows);
+    for(unsigned int ii = 0; ii < rows; ii++) {
+      unsigned long long offset = 0;
+      for(int jj = 0; jj < width; jj++) {
+        offset |= (unsigned long long)bytes[ii*width + jj] << (8*jj);
+      }
+      values[col][ii] = (long long)(base + offset);
+    }
+  }
+  return true;
+}
+
+unsigned int binreader::getColumns() const {
+  return columns;
+}
+
+unsigned int binreader::getMode() const {
+  return mode;
+}
+
+const char* binreader::columnName(int index) {
+  return colnames[index];
+}
@@ -0,0 +1,88 @@
+#ifndef BINOUT_H
+#define BINOUT_H
+#include <string>
+#include <vector>
+#include <iostream>
+#include "venmoio.h"
+
+// Columns of binary median output, bit mask in file header. Present
+// columns are stored in this order.
+#define BIN_RECORD  1    // record index, or run length for rle output
+#define BIN_MEDIAN  2    // twice the median, always present
+#define BIN_EDGES   4    // edges in window
+#define BIN_NODES   8    // nodes in window
+#define BIN_EPOCH  16    // epoch time of newest record
+#define BIN_NCOLS   5
+
+// Rows per block
+#define BINBLOCK 4096
+
+// Binary columnar median file, all numbers little endian:
+//
+//   header, 32 bytes:
+//     char[8]  magic "RMEDBIN1"
+//     uint32   version, 1
+//     uint32   column mask, BIN_* above
+//     uint32   rows per block
+//     uint32   emitter mode the file was written with, see emitter.h
+//     uint32   reserved, 0
+//     uint32   reserved, 0
+//   blocks until end of file:
+//     uint32   rows in block
+//     for each present column:
+//       uint8    width in bytes of each value: 0, 1, 2, 4 or 8
+//       int64    base, the smallest value in the block
+//       rows values of value - base, width bytes each
+//
+// Each block stores a column with the fewest bytes that hold its range
+// of values, usually one byte for medians and zero for columns that do
+// not change within a block, so files are several times smaller than
+// the text output.
+struct binrow {
+  long long values[BIN_NCOLS];
+};
+
+class binwriter {
+protected:
+  venmoio* vio;
+  unsigned int columns, mode;
+  bool started;
+  std::vector<long long> values[BIN_NCOLS];
+  std::string buffer;
+  void put32(unsigned int value);
+  void put64(unsigned long long value);
+  void writeHeader();
+  void writeBlock();
+
+public:
+  binwriter(venmoio* vio, unsigned int columns, unsigned int mode):
+    vio(vio), columns(columns | BIN_MEDIAN), mode(mode), started(false) {};
+  void setMode(unsigned int mymode);
+  void put(const binrow& row);
+  // Write pending rows, the next row starts a new file with a header
+  void finish();
+
+  // Parse "text" or "bin" with optional ":" and comma separated extra
+  // columns "edges", "nodes", "epoch". Column mask 0 means text.
+  static bool parseFormat(const char* spec, unsigned int& mycolumns);
+};
+
+class binreader {
+protected:
+  std::istream& in;
+  unsigned int columns, mode, blockrows;
+  bool get32(unsigned int& value);
+  bool get64(unsigned long long& value);
+
+public:
+  binreader(std::istream& in): in(in), columns(0), mode(0), blockrows(0) {};
+  // Read header, false if input is empty, aborts if it is no median file
+  bool readHeader();
+  // Read next block into values by column index, false at end of file
+  bool readBlock(std::vector<long long> values[BIN_NCOLS], unsigned int& rows);
+  unsigned int getColumns() const;
+  unsigned int getMode() const;
+  static const char* columnName(int index);
+};
+
+#endif
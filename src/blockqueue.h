@@ -0,0 +1,64 @@
+#ifndef BLOCKQUEUE_H
+#define BLOCKQUEUE_H
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// Bounded first-in first-out queue handing blocks of work from one thread
+// to another. push blocks while the queue holds capacity items, which
+// throttles a fast producer to the speed of its consumer, and pop blocks
+// while the queue is empty. After close, pop drains remaining items and
+// then returns false. Template, so it lives entirely in this header.
+template <class T>
+class BlockQueue {
+protected:
+  std::deque<T> items;
+  std::size_t capacity;
+  bool closed;
+  std::mutex mtx;
+  std::condition_variable notfull, notempty;
+
+public:
+  BlockQueue(std::size_t capacity = 8):
+    capacity(capacity ? capacity : 1), closed(false) {};
+
+  // Append item, waiting for room. Returns false if queue was closed.
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock(mtx);
+    while( ! closed && items.size() >= capacity ) {
+      notfull.wait(lock);
+    }
+    if( closed ) {
+      return false;
+    }
+    items.push_back(std::move(item));
+    notempty.notify_one();
+    return true;
+  }
+
+  // Remove oldest item into item, waiting for one to arrive.
+  // Returns false once the queue is closed and drained.
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> lock(mtx);
+    while( ! closed && items.empty() ) {
+      notempty.wait(lock);
+    }
+    if( items.empty() ) {
+      return false;
+    }
+    item = std::move(items.front());
+    items.pop_front();
+    notfull.notify_one();
+    return true;
+  }
+
+  // No more pushes, wake everybody waiting
+  void close() {
+    std::lock_guard<std::mutex> lock(mtx);
+    closed = true;
+    notfull.notify_all();
+    notempty.notify_all();
+  }
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include <cstdio>
+#include <cstring>      // memcmp
+#include <vector>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "decompress.h"
+#include "stringutils.h"
+
+// Size of decompressed blocks handed to the parser
+#define DECOMPBLOCK (1 << 18)
+
+
+// Stop the worker, even if the parser did not read up to the end
+decompbuf::~decompbuf() {
+  queue.close();
+  if( worker.joinable() ) {
+    worker.join();
+  }
+}
+
+int decompbuf::detect(const char* fname) {
+  unsigned char magic[4] = {0, 0, 0, 0};
+  FILE* fp = fopen(fname, "rb");
+  if( NULL == fp ) {
+    return FORMAT_PLAIN;
+  }
+  size_t nread = fread(magic, 1, sizeof(magic), fp);
+  fclose(fp);
+  static const unsigned char gzmagic[] = {0x1f, 0x8b};
+  static const unsigned char zstmagic[] = {0x28, 0xb5, 0x2f, 0xfd};
+  if( nread >= 2 && 0 == memcmp(magic, gzmagic, 2) ) {
+    return FORMAT_GZIP;
+  }
+  if( nread >= 4 && 0 == memcmp(magic, zstmagic, 4) ) {
+    return FORMAT_ZSTD;
+  }
+  return FORMAT_PLAIN;
+}
+
+bool decompbuf::supported(int format) {
+  switch( format ) {
+#ifdef HAVE_ZLIB
+    case FORMAT_GZIP:
+      return true;
+#endif
+#ifdef HAVE_ZSTD
+    case FORMAT_ZSTD:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+// Open compressed file and start decompressing on the worker thread
+bool decompbuf::open(const char* fname, int myformat) {
+  format = myformat;
+  if( ! supported(format) ) {
+    stu::abortf("%s is compressed in a format this build does not support\n",
+      fname);
+  }
+#ifdef HAVE_ZLIB
+  if( FORMAT_GZIP == format ) {
+    gzFile gzf = gzopen(fname, "rb");
+    if( NULL == gzf ) {
+      return false;
+    }
+    // larger internal buffer reduces read calls on the compressed file
+    gzbuffer(gzf, DECOMPBLOCK);
+    handle = gzf;
+    worker = std::thread(&decompbuf::inflateGzip, this);
+  }
+#endif
+#ifdef HAVE_ZSTD
+  if( FORMAT_ZSTD == format ) {
+    FILE* fp = fopen(fname, "rb");
+    if( NULL == fp ) {
+      return false;
+    }
+    handle = fp;
+    worker = std::thread(&decompbuf::inflateZstd, this);
+  }
+#endif
+  return true;
+}
+
+// Hand next decompressed block to the istream reading from us
+decompbuf::int_type decompbuf::underflow() {
+  if( gptr() < egptr() ) {
+    return traits_type::to_int_type(*gptr());
+  }
+  if( ! queue.pop(current) ) {
+    return traits_type::eof();
+  }
+  setg(&current[0], &current[0], &current[0] + current.size());
+  return traits_type::to_int_type(*gptr());
+}
+
+// Worker thread body for gzip, gzread also handles concatenated members
+void decompbuf::inflateGzip() {
+#ifdef HAVE_ZLIB
+  gzFile gzf = static_cast<gzFile>(handle);
+  int nread;
+  do {
+    std::vector<char> block(DECOMPBLOCK);
+    nread = gzread(gzf, &block[0], DECOMPBLOCK);
+    if( nread < 0 ) {
+      int errnum;
+      stu::abortf("Error decompressing input: %s\n", gzerror(gzf, &errnum));
+    }
+    block.resize(nread);
+    if( nread > 0 && ! queue.push(std::move(block)) ) {
+      // reader went away
+      break;
+    }
+  } while( nread > 0 );
+  // a stream cut short ends without a read error, but leaves one set
+  int errnum = Z_OK;
+  const char* errmsg = gzerror(gzf, &errnum);
+  if( nread == 0 && Z_OK != errnum ) {
+    stu::abortf("Error decompressing input: %s\n", errmsg);
+  }
+  gzclose(gzf);
+  handle = NULL;
+  queue.close();
+#endif
+}
+
+// Worker thread body for zstd streaming decompression. Each read is
+// decompressed until the input is used up and the last call left room
+// in its output block, as a full block may mean the decoder still holds
+// data. At the end of the file the last frame must be complete, which
+// ZSTD_decompressStream reports by returning 0.
+void decompbuf::inflateZstd() {
+#ifdef HAVE_ZSTD
+  FILE* fp = static_cast<FILE*>(handle);
+  ZSTD_DCtx* dctx = ZSTD_createDCtx();
+  std::vector<char> inbuf(ZSTD_DStreamInSize());
+  size_t nread, ret = 0;
+  bool reading = true;
+  while( reading && 0 < (nread = fread(&inbuf[0], 1, inbuf.size(), fp)) ) {
+    ZSTD_inBuffer input = { &inbuf[0], nread, 0 };
+    bool full;
+    do {
+      std::vector<char> block(DECOMPBLOCK);
+      ZSTD_outBuffer output = { &block[0], block.size(), 0 };
+      ret = ZSTD_decompressStream(dctx, &output, &input);
+      if( ZSTD_isError(ret) ) {
+        stu::abortf("Error decompressing input: %s\n", ZSTD_getErrorName(ret));
+      }
+      full = (output.pos == output.size);
+      block.resize(output.pos);
+      if( output.pos > 0 && ! queue.push(std::move(block)) ) {
+        reading = false;
+        break;
+      }
+    } while( input.pos < input.size || full );
+  }
+  if( reading && ferror(fp) ) {
+    stu::abortf("Error reading compressed input\n");
+  }
+  if( reading && 0 != ret ) {
+    stu::abortf("Error decompressing input: truncated zstd frame\n");
+  }
+  ZSTD_freeDCtx(dctx);
+  fclose(fp);
+  handle = NULL;
+  queue.close();
+#endif
+}
@@ -0,0 +1,40 @@
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+#include <streambuf>
+#include <vector>
+#include <thread>
+#include "blockqueue.h"
+
+// Input formats recognized by their leading magic bytes
+#define FORMAT_PLAIN 0
+#define FORMAT_GZIP  1
+#define FORMAT_ZSTD  2
+
+// Stream buffer reading a compressed file. A helper thread decompresses
+// into blocks of DECOMPBLOCK bytes and hands them over through a short
+// bounded queue, so decompression overlaps with line parsing, and no
+// decompressed copy is ever written to disk. Plugs into std::istream,
+// so the line parser reads it like any ifstream.
+class decompbuf : public std::streambuf {
+protected:
+  BlockQueue< std::vector<char> > queue;
+  std::vector<char> current;
+  std::thread worker;
+  void* handle;
+  int format;
+  void inflateGzip();
+  void inflateZstd();
+  virtual int_type underflow();
+
+public:
+  decompbuf(): queue(4), handle(NULL), format(FORMAT_PLAIN) {};
+  virtual ~decompbuf();
+  bool open(const char* fname, int format);
+
+  // Guess format from file content, falls back to FORMAT_PLAIN
+  static int detect(const char* fname);
+  // True if support for format was compiled in
+  static bool supported(int format);
+};
+
+#endif
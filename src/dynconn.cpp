@@ -0,0 +1,491 @@
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cassert>       // assert
+#include "dynconn.h"
+
+
+DynConn::~DynConn() {
+  clear();
+}
+
+// xorshift32 for treap priorities
+uint DynConn::random() {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+unsigned long long DynConn::key(uint u, uint v) {
+  if( u > v ) {
+    uint temp = u;
+    u = v;
+    v = temp;
+  }
+  return ((unsigned long long)u << 32) | v;
+}
+
+// Recompute subtree aggregates of node from its children
+void DynConn::update(EtNode* node) {
+  node->cnt = 1;
+  node->nvert = (NOVERTEX != node->vertex);
+  node->ntree = node->treeflag;
+  node->nnon = node->nonflag;
+  EtNode* children[2] = {node->left, node->right};
+  for(int ii = 0; ii < 2; ii++) {
+    if( NULL != children[ii] ) {
+      node->cnt += children[ii]->cnt;
+      node->nvert += children[ii]->nvert;
+      node->ntree += children[ii]->ntree;
+      node->nnon += children[ii]->nnon;
+    }
+  }
+}
+
+// Update aggregates from node up to the root, after a flag changed
+void DynConn::refresh(EtNode* node) {
+  while( NULL != node ) {
+    update(node);
+    node = node->parent;
+  }
+}
+
+EtNode* DynConn::root(EtNode* node) {
+  while( NULL != node->parent ) {
+    node = node->parent;
+  }
+  return node;
+}
+
+// Position of node in its tour
+uint DynConn::index(EtNode* node) {
+  uint pos = (NULL != node->left) ? node->left->cnt : 0;
+  while( NULL != node->parent ) {
+    if( node == node->parent->right ) {
+      pos += 1 + ((NULL != node->parent->left) ? node->parent->left->cnt : 0);
+    }
+    node = node->parent;
+  }
+  return pos;
+}
+
+// Concatenate two tours given by their roots
+EtNode* DynConn::merge(EtNode* left, EtNode* right) {
+  if( NULL == left ) {
+    return right;
+  }
+  if( NULL == right ) {
+    return left;
+  }
+  EtNode* top;
+  if( left->prio > right->prio ) {
+    left->right = merge(left->right, right);
+    left->right->parent = left;
+    top = left;
+  } else {
+    right->left = merge(left, right->left);
+    right->left->parent = right;
+    top = right;
+  }
+  update(top);
+  top->parent = NULL;
+  return top;
+}
+
+// Split tour with root node into its first count nodes and the rest
+void DynConn::split(EtNode* node, uint count, EtNode*& left, EtNode*& right) {
+  if( NULL == node ) {
+    left = right = NULL;
+    return;
+  }
+  uint leftcnt = (NULL != node->left) ? node->left->cnt : 0;
+  if( count <= leftcnt ) {
+    EtNode* mid;
+    split(node->left, count, left, mid);
+    node->left = mid;
+    if( NULL != mid ) {
+      mid->parent = node;
+    }
+    right = node;
+  } else {
+    EtNode* mid;
+    split(node->right, count - leftcnt - 1, mid, right);
+    node->right = mid;
+    if( NULL != mid ) {
+      mid->parent = node;
+    }
+    left = node;
+  }
+  update(node);
+  if( NULL != left ) {
+    left->parent = NULL;
+  }
+  if( NULL != right ) {
+    right->parent = NULL;
+  }
+}
+
+// Rotate tour of node so that it starts at node, returns new root
+EtNode* DynConn::reroot(EtNode* node) {
+  EtNode* left;
+  EtNode* right;
+  split(root(node), index(node), left, right);
+  return merge(right, left);
+}
+
+// Some arc in tour with root node that is flagged as tree edge
+EtNode* DynConn::findTree(EtNode* node) {
+  while( true ) {
+    if( NULL != node->left && node->left->ntree > 0 ) {
+      node = node->left;
+    } else if( node->treeflag ) {
+      return node;
+    } else {
+      node = node->right;
+    }
+  }
+}
+
+// Some vertex in tour with root node that has non-tree edges
+EtNode* DynConn::findNon(EtNode* node) {
+  while( true ) {
+    if( NULL != node->left && node->left->nnon > 0 ) {
+      node = node->left;
+    } else if( node->nonflag ) {
+      return node;
+    } else {
+      node = node->right;
+    }
+  }
+}
+
+void DynConn::ensureLevel(uint level) {
+  while( vnodes.size() <= level ) {
+    vnodes.push_back(std::vector<EtNode*>(vertexrange, (EtNode*)NULL));
+    nontree.push_back(std::vector< std::vector<uint> >(vertexrange));
+  }
+}
+
+EtNode* DynConn::vertexNode(uint vertex, uint level) {
+  ensureLevel(level);
+  if( NULL == vnodes[level][vertex] ) {
+    vnodes[level][vertex] = new EtNode(vertex, NOVERTEX, random());
+    vertexnodes++;
+  }
+  return vnodes[level][vertex];
+}
+
+// Root of tree of vertex in F_level, NULL if vertex is alone there
+EtNode* DynConn::treeOf(uint vertex, uint level) const {
+  if( level >= vnodes.size() || NULL == vnodes[level][vertex] ) {
+    return NULL;
+  }
+  return root(vnodes[level][vertex]);
+}
+
+uint DynConn::treeSize(uint vertex, uint level) const {
+  EtNode* top = treeOf(vertex, level);
+  return (NULL == top) ? 1 : top->nvert;
+}
+
+bool DynConn::connected(uint u, uint v, uint level) const {
+  if( u == v ) {
+    return true;
+  }
+  EtNode* top = treeOf(u, level);
+  return NULL != top && top == treeOf(v, level);
+}
+
+// Join the trees of the ends of edge in F_level: rotate both tours to
+// start at the ends and concatenate them with the two arcs in between
+void DynConn::link(uint edge, uint level) {
+  ConnEdge& myedge = edges[edge];
+  if( myedge.arcs.size() < 2*(level + 1) ) {
+    myedge.arcs.resize(2*(level + 1), NULL);
+  }
+  EtNode* arc1 = new EtNode(NOVERTEX, edge, random());
+  EtNode* arc2 = new EtNode(NOVERTEX, edge, random());
+  arcnodes += 2;
+  arc1->treeflag = (myedge.level == level);
+  update(arc1);
+  myedge.arcs[2*level] = arc1;
+  myedge.arcs[2*level + 1] = arc2;
+  EtNode* tourv = reroot(vertexNode(myedge.v, level));
+  EtNode* touru = reroot(vertexNode(myedge.u, level));
+  merge(merge(merge(touru, arc1), tourv), arc2);
+}
+
+// Remove edge from F_level: the tour is A arc B arc C, the part B
+// between the arcs becomes one tree, A C the other
+void DynConn::cut(uint edge, uint level) {
+  EtNode* arc1 = edges[edge].arcs[2*level];
+  EtNode* arc2 = edges[edge].arcs[2*level + 1];
+  uint pos1 = index(arc1);
+  uint pos2 = index(arc2);
+  if( pos1 > pos2 ) {
+    EtNode* temp = arc1;
+    arc1 = arc2;
+    arc2 = temp;
+    uint tmppos = pos1;
+    pos1 = pos2;
+    pos2 = tmppos;
+  }
+  EtNode *head, *tail, *mid, *single;
+  split(root(arc1), pos2 + 1, head, tail);
+  split(head, pos2, head, single);
+  split(head, pos1 + 1, head, mid);
+  split(head, pos1, head, single);
+  merge(head, tail);
+  delete arc1;
+  delete arc2;
+  arcnodes -= 2;
+  edges[edge].arcs[2*level] = edges[edge].arcs[2*level + 1] = NULL;
+}
+
+// Vertex flag mirrors whether its non-tree list of level is empty
+void DynConn::setNonFlag(uint vertex, uint level) {
+  EtNode* node = vertexNode(vertex, level);
+  bool flag = ! nontree[level][vertex].empty();
+  if( node->nonflag != flag ) {
+    node->nonflag = flag;
+    refresh(node);
+  }
+}
+
+void DynConn::addNonTree(uint edge, uint level) {
+  ensureLevel(level);
+  ConnEdge& myedge = edges[edge];
+  myedge.level = level;
+  myedge.tree = false;
+  myedge.posu = nontree[level][myedge.u].size();
+  nontree[level][myedge.u].push_back(edge);
+  myedge.posv = nontree[level][myedge.v].size();
+  nontree[level][myedge.v].push_back(edge);
+  if( 1 == nontree[level][myedge.u].size() ) {
+    setNonFlag(myedge.u, level);
+  }
+  if( 1 == nontree[level][myedge.v].size() ) {
+    setNonFlag(myedge.v, level);
+  }
+}
+
+// Take edge out of both non-tree lists, moving the last entries into
+// the gaps
+void DynConn::removeNonTree(uint edge) {
+  uint level = edges[edge].level;
+  uint ends[2] = {edges[edge].u, edges[edge].v};
+  std::size_t pos[2] = {edges[edge].posu, edges[edge].posv};
+  for(int ii = 0; ii < 2; ii++) {
+    std::vector<uint>& list = nontree[level][ends[ii]];
+    uint moved = list.back();
+    list[pos[ii]] = moved;
+    list.pop_back();
+    if( moved != edge ) {
+      if( edges[moved].u == ends[ii] ) {
+        edges[moved].posu = pos[ii];
+      } else {
+        edges[moved].posv = pos[ii];
+      }
+    }
+    if( list.empty() ) {
+      setNonFlag(ends[ii], level);
+    }
+  }
+}
+
+// Look for a replacement of deleted tree edge, from its level down.
+// At each level the smaller of the two trees has its tree edges of that
+// level raised, then its non-tree edges of that level are tried one by
+// one, each either reconnecting the trees or getting raised.
+bool DynConn::replace(uint edge) {
+  uint u = edges[edge].u;
+  uint v = edges[edge].v;
+  for(int level = edges[edge].level; level >= 0; level--) {
+    uint small = (treeSize(u, level) <= treeSize(v, level)) ? u : v;
+    EtNode* top;
+    while( NULL != (top = treeOf(small, level)) && top->ntree > 0 ) {
+      EtNode* arc = findTree(top);
+      arc->treeflag = false;
+      refresh(arc);
+      edges[arc->edge].level = level + 1;
+      link(arc->edge, level + 1);
+    }
+    while( NULL != (top = treeOf(small, level)) && top->nnon > 0 ) {
+      uint vertex = findNon(top)->vertex;
+      uint other = nontree[level][vertex].back();
+      removeNonTree(other);
+      uint far = (edges[other].u == vertex) ? edges[other].v : edges[other].u;
+      if( ! connected(far, small, level) ) {
+        edges[other].tree = true;
+        edges[other].level = level;
+        for(int mylevel = 0; mylevel <= level; mylevel++) {
+          link(other, mylevel);
+        }
+        ntreeedges++;
+        return true;
+      }
+      addNonTree(other, level + 1);
+    }
+  }
+  return false;
+}
+
+void DynConn::addSize(uint size) {
+  sizes[size]++;
+}
+
+void DynConn::removeSize(uint size) {
+  std::map<uint, uint>::iterator it = sizes.find(size);
+  assert( sizes.end() != it );
+  if( 0 == --it->second ) {
+    sizes.erase(it);
+  }
+}
+
+uint DynConn::addVertex() {
+  uint vertex;
+  if( freevertices.empty() ) {
+    vertex = vertexrange++;
+    for(std::size_t level = 0; level < vnodes.size(); level++) {
+      vnodes[level].push_back(NULL);
+      nontree[level].push_back(std::vector<uint>());
+    }
+  } else {
+    vertex = freevertices.back();
+    freevertices.pop_back();
+  }
+  nvertices++;
+  addSize(1);
+  return vertex;
+}
+
+void DynConn::removeVertex(uint vertex) {
+  for(std::size_t level = 0; level < vnodes.size(); level++) {
+    EtNode* node = vnodes[level][vertex];
+    if( NULL != node ) {
+      assert( 1 == node->cnt && NULL == node->parent );
+      assert( nontree[level][vertex].empty() );
+      delete node;
+      vertexnodes--;
+      vnodes[level][vertex] = NULL;
+    }
+  }
+  freevertices.push_back(vertex);
+  nvertices--;
+  removeSize(1);
+}
+
+void DynConn::addEdge(uint u, uint v) {
+  if( u == v ) {
+    return;
+  }
+  uint edge;
+  if( freeedges.empty() ) {
+    edge = edges.size();
+    edges.push_back(ConnEdge());
+  } else {
+    edge = freeedges.back();
+    freeedges.pop_back();
+  }
+  ConnEdge& myedge = edges[edge];
+  myedge.u = u;
+  myedge.v = v;
+  myedge.level = 0;
+  edgeids[key(u, v)] = edge;
+  if( connected(u, v, 0) ) {
+    addNonTree(edge, 0);
+  } else {
+    uint sizeu = treeSize(u, 0);
+    uint sizev = treeSize(v, 0);
+    myedge.tree = true;
+    link(edge, 0);
+    ntreeedges++;
+    removeSize(sizeu);
+    removeSize(sizev);
+    addSize(sizeu + sizev);
+  }
+}
+
+void DynConn::removeEdge(uint u, uint v) {
+  if( u == v ) {
+    return;
+  }
+  std::unordered_map<unsigned long long, uint>::iterator it =
+    edgeids.find(key(u, v));
+  assert( edgeids.end() != it );
+  uint edge = it->second;
+  edgeids.erase(it);
+  if( ! edges[edge].tree ) {
+    removeNonTree(edge);
+  } else {
+    uint total = treeSize(u, 0);
+    for(uint level = 0; level <= edges[edge].level; level++) {
+      cut(edge, level);
+    }
+    ntreeedges--;
+    if( ! replace(edge) ) {
+      // component fell apart
+      removeSize(total);
+      addSize(treeSize(u, 0));
+      addSize(treeSize(v, 0));
+    }
+  }
+  edges[edge].u = edges[edge].v = NOVERTEX;
+  edges[edge].arcs.clear();
+  freeedges.push_back(edge);
+}
+
+void DynConn::clear() {
+  for(std::size_t level = 0; level < vnodes.size(); level++) {
+    for(std::size_t vertex = 0; vertex < vnodes[level].size(); vertex++) {
+      delete vnodes[level][vertex];
+    }
+  }
+  for(std::size_t edge = 0; edge < edges.size(); edge++) {
+    for(std::size_t ii = 0; ii < edges[edge].arcs.size(); ii++) {
+      delete edges[edge].arcs[ii];
+    }
+  }
+  edges.clear();
+  freeedges.clear();
+  edgeids.clear();
+  vnodes.clear();
+  nontree.clear();
+  freevertices.clear();
+  sizes.clear();
+  nvertices = vertexrange = ntreeedges = 0;
+  vertexnodes = arcnodes = 0;
+  ensureLevel(0);
+}
+
+std::size_t DynConn::bytes() const {
+  std::size_t bytes = (vertexnodes + arcnodes) * sizeof(EtNode)
+    + edges.capacity() * sizeof(ConnEdge)
+    + (freeedges.capacity() + freevertices.capacity()) * sizeof(uint)
+    + edgeids.bucket_count() * sizeof(void*)
+    + edgeids.size() * (sizeof(std::pair<unsigned long long, uint>)
+                        + sizeof(void*))
+    + sizes.size() * (sizeof(std::pair<uint, uint>) + 4 * sizeof(void*));
+  for(std::size_t level = 0; level < vnodes.size(); level++) {
+    bytes += vnodes[level].capacity() * sizeof(EtNode*)
+      + nontree[level].capacity() * sizeof(std::vector<uint>);
+  }
+  // arc pointers of tree edges, each non-tree edge in the lists of
+  // both ends
+  bytes += arcnodes * sizeof(EtNode*)
+    + 2 * (edgeids.size() - ntreeedges) * sizeof(uint);
+  return bytes;
+}
+
+uint DynConn::components() const {
+  return nvertices - ntreeedges;
+}
+
+uint DynConn::largest() const {
+  return sizes.empty() ? 0 : sizes.rbegin()->first;
+}
+
+uint DynConn::componentSize(uint vertex) const {
+  return treeSize(vertex, 0);
+}
@@ -0,0 +1,127 @@
+#ifndef DYNCONN_H
+#define DYNCONN_H
+#include <cstddef>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+// For convenience
+typedef unsigned int uint;
+
+// Marks arc nodes of Euler tours, and unused edge ids
+#define NOVERTEX 0xFFFFFFFFU
+
+// Treap node of an Euler tour: either the single occurrence of a vertex
+// or one of the two arcs of a tree edge. Sequence order is implicit in
+// the tree shape, subtree aggregates allow counting and searching.
+struct EtNode {
+  EtNode* left;
+  EtNode* right;
+  EtNode* parent;
+  uint prio;
+  // vertex id, or NOVERTEX for arcs, which carry their edge id instead
+  uint vertex, edge;
+  // arc: edge is a tree edge of exactly this level, set on one arc only
+  bool treeflag;
+  // vertex: has non-tree edges of this level
+  bool nonflag;
+  // subtree sizes: all nodes, vertex nodes, tree flags, non-tree flags
+  uint cnt, nvert, ntree, nnon;
+  EtNode(uint vertex, uint edge, uint prio):
+    left(NULL), right(NULL), parent(NULL), prio(prio), vertex(vertex),
+    edge(edge), treeflag(false), nonflag(false),
+    cnt(1), nvert(NOVERTEX != vertex), ntree(0), nnon(0) {};
+};
+
+// Edge as seen by DynConn. Tree edges have two arcs per level from 0 to
+// their level, non-tree edges sit in the adjacency lists of their level.
+struct ConnEdge {
+  uint u, v, level;
+  bool tree;
+  // index in non-tree lists of u and v
+  std::size_t posu, posv;
+  std::vector<EtNode*> arcs;
+};
+
+// Fully dynamic connectivity after Holm, de Lichtenberg and Thorup:
+// every edge has a level, initially 0, that only goes up, and F_i is a
+// spanning forest of the edges of level i or more, so F_0 spans the
+// whole graph. Trees of F_i have at most n / 2^i vertices, so levels
+// stay below log2(n). Deleting a tree edge searches the smaller of the
+// two halves for a replacement, from its level down to 0, and raises
+// the level of every edge it looks at without success, which pays for
+// the search: O(log^2 n) amortized per update. Each forest is kept as
+// Euler tours in treaps, with subtree flags that find the edges to
+// raise and the non-tree edges to try without scanning.
+//
+// Vertices are small integer ids handed out by addVertex. Also keeps
+// the number of components and a histogram of component sizes.
+class DynConn {
+protected:
+  std::vector<ConnEdge> edges;
+  std::vector<uint> freeedges;
+  std::unordered_map<unsigned long long, uint> edgeids;
+  // vertex node per level and vertex, created when first needed
+  std::vector< std::vector<EtNode*> > vnodes;
+  // non-tree edges per level and vertex
+  std::vector< std::vector< std::vector<uint> > > nontree;
+  std::vector<uint> freevertices;
+  uint nvertices, vertexrange, ntreeedges;
+  // treap nodes allocated for vertices and for arcs
+  std::size_t vertexnodes, arcnodes;
+  // number of components by size
+  std::map<uint, uint> sizes;
+  uint seed;
+
+  uint random();
+  static void update(EtNode* node);
+  static void refresh(EtNode* node);
+  static EtNode* root(EtNode* node);
+  static uint index(EtNode* node);
+  static EtNode* merge(EtNode* left, EtNode* right);
+  static void split(EtNode* node, uint count, EtNode*& left, EtNode*& right);
+  static EtNode* reroot(EtNode* node);
+  static EtNode* findTree(EtNode* node);
+  static EtNode* findNon(EtNode* node);
+
+  void ensureLevel(uint level);
+  EtNode* vertexNode(uint vertex, uint level);
+  EtNode* treeOf(uint vertex, uint level) const;
+  uint treeSize(uint vertex, uint level) const;
+  bool connected(uint u, uint v, uint level) const;
+  void link(uint edge, uint level);
+  void cut(uint edge, uint level);
+  void addNonTree(uint edge, uint level);
+  void removeNonTree(uint edge);
+  void setNonFlag(uint vertex, uint level);
+  bool replace(uint edge);
+  void addSize(uint size);
+  void removeSize(uint size);
+  static unsigned long long key(uint u, uint v);
+
+public:
+  DynConn(): nvertices(0), vertexrange(0), ntreeedges(0), vertexnodes(0),
+    arcnodes(0),
+    seed(2463534242U) {
+    ensureLevel(0);
+  };
+  ~DynConn();
+  // New isolated vertex, returns its id
+  uint addVertex();
+  // Vertex must have no edges left, its id gets reused
+  void removeVertex(uint vertex);
+  // At most one edge per vertex pair, self loops are ignored
+  void addEdge(uint u, uint v);
+  void removeEdge(uint u, uint v);
+  // Remove all vertices and edges
+  void clear();
+  uint components() const;
+  uint largest() const;
+  // Size of component of vertex
+  uint componentSize(uint vertex) const;
+  // Bytes of forests, edge records and lists by object size, with
+  // non-tree lists taken as full and one tree node per map entry
+  std::size_t bytes() const;
+};
+
+#endif
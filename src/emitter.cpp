@@ -0,0 +1,178 @@
+#include <string>
+#include <sstream>       // std::ostringstream
+#include <cstring>       // strcmp, strncmp
+#include <cstdlib>       // strtoul
+#include "venmoio.h"
+#include "emitter.h"
+
+
+emitter::~emitter() {
+  delete bin;
+}
+
+void emitter::setMode(int mymode, unsigned long myevery) {
+  mode = mymode;
+  every = myevery ? myevery : 1;
+  if( NULL != bin ) {
+    bin->setMode(mode);
+  }
+}
+
+void emitter::setBinary(unsigned int columns) {
+  delete bin;
+  bin = NULL;
+  if( 0 != columns ) {
+    if( EMIT_ALL != mode ) {
+      columns |= BIN_RECORD;
+    }
+    bin = new binwriter(vio, columns, mode);
+  }
+}
+
+void emitter::resume(const emitter& other) {
+  mode = other.mode;
+  every = other.every;
+  recnum = other.recnum;
+  runlen = other.runlen;
+  nextemit = other.nextemit;
+  last = other.last;
+  haslast = other.haslast;
+}
+
+bool emitter::binary() const {
+  return NULL != bin;
+}
+
+bool emitter::due(time_t now) {
+  recnum++;
+  switch( mode ) {
+    case EMIT_NTH:
+      return 0 == recnum % every;
+    case EMIT_SECONDS:
+      // first record of each period of every seconds, aligned to epoch
+      if( now >= nextemit || recnum == 1 ) {
+        nextemit = (now / (time_t)every + 1) * (time_t)every;
+        return true;
+      }
+      return false;
+    default:
+      // change detection and run lengths need every median
+      return true;
+  }
+}
+
+void emitter::put(unsigned int med2) {
+  putText(format(med2));
+}
+
+void emitter::putText(const std::string& text) {
+  switch( mode ) {
+    case EMIT_ALL:
+      vio->outStr(text + "\n");
+      break;
+    case EMIT_CHANGE:
+      if( ! haslast || text != last ) {
+        std::ostringstream outstr;
+        outstr << recnum << " " << text << std::endl;
+        vio->outStr(outstr.str());
+      }
+      break;
+    case EMIT_NTH:
+    case EMIT_SECONDS: {
+      std::ostringstream outstr;
+      outstr << recnum << " " << text << std::endl;
+      vio->outStr(outstr.str());
+      break;
+    }
+    case EMIT_RLE:
+      if( haslast && text != last ) {
+        writeRun();
+      }
+      runlen++;
+      break;
+  }
+  last = text;
+  haslast = true;
+}
+
+// Same decisions as putText, comparing medians instead of text
+void emitter::putRow(unsigned int med2, unsigned int edges,
+                     unsigned int nodes, time_t epoch) {
+  if( NULL == bin ) {
+    put(med2);
+    return;
+  }
+  binrow row = {{(long long)recnum, med2, edges, nodes, epoch}};
+  switch( mode ) {
+    case EMIT_CHANGE:
+      if( ! haslast || med2 != lastrow.values[1] ) {
+        bin->put(row);
+      }
+      break;
+    case EMIT_RLE:
+      if( haslast && med2 != lastrow.values[1] ) {
+        writeRun();
+      }
+      runlen++;
+      break;
+    default:
+      bin->put(row);
+  }
+  lastrow = row;
+  haslast = true;
+}
+
+// Run length and median of the last run, with the other columns of its
+// last record
+void emitter::writeRun() {
+  if( NULL != bin ) {
+    lastrow.values[0] = runlen;
+    bin->put(lastrow);
+    runlen = 0;
+    return;
+  }
+  std::ostringstream outstr;
+  outstr << runlen << " " << last << std::endl;
+  vio->outStr(outstr.str());
+  runlen = 0;
+}
+
+void emitter::finish() {
+  if( EMIT_RLE == mode && runlen > 0 ) {
+    writeRun();
+  }
+  if( NULL != bin ) {
+    bin->finish();
+  }
+  recnum = 0;
+  runlen = 0;
+  nextemit = 0;
+  haslast = false;
+}
+
+std::string emitter::format(unsigned int med2) {
+  std::ostringstream outstr;
+  outstr << (med2 >> 1) << "." << ((med2 & 1) ? "5" : "0") << "0";
+  return outstr.str();
+}
+
+bool emitter::parseMode(const char* spec, int& mymode,
+                        unsigned long& myevery) {
+  myevery = 1;
+  if( 0 == strcmp(spec, "all") ) {
+    mymode = EMIT_ALL;
+  } else if( 0 == strcmp(spec, "change") ) {
+    mymode = EMIT_CHANGE;
+  } else if( 0 == strcmp(spec, "rle") ) {
+    mymode = EMIT_RLE;
+  } else if( 0 == strncmp(spec, "every:", 6) ) {
+    mymode = EMIT_NTH;
+    myevery = strtoul(spec + 6, NULL, 10);
+  } else if( 0 == strncmp(spec, "seconds:", 8) ) {
+    mymode = EMIT_SECONDS;
+    myevery = strtoul(spec + 8, NULL, 10);
+  } else {
+    return false;
+  }
+  return myevery > 0;
+}
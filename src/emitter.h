@@ -0,0 +1,66 @@
+#ifndef EMITTER_H
+#define EMITTER_H
+#include <string>
+#include <time.h>       // time_t
+#include "venmoio.h"
+#include "binout.h"
+
+// Output modes, see emitter::parseMode for their command line names
+#define EMIT_ALL     0   // one median line per record
+#define EMIT_CHANGE  1   // "record median" whenever the median changes
+#define EMIT_NTH     2   // "record median" for every N-th record
+#define EMIT_SECONDS 3   // "record median" once per T seconds of input time
+#define EMIT_RLE     4   // "count median" runs of equal medians
+
+// Decides which medians get written and writes them. Engines call due
+// once per record and compute the median only if it returns true, then
+// hand it to put. Medians travel as twice the median, an integer, since
+// a median of integer degrees is always integer or half-integer. Engines
+// with several medians per record format them and call putText.
+// After setBinary, output goes to the binary format of binout.h, for
+// which engines call putRow with the extra columns instead of put.
+class emitter {
+protected:
+  venmoio* vio;
+  int mode;
+  unsigned long every;
+  unsigned long long recnum, runlen;
+  time_t nextemit;
+  std::string last;
+  bool haslast;
+  binwriter* bin;
+  binrow lastrow;
+  void writeRun();
+
+public:
+  emitter(venmoio* vio, int mode = EMIT_ALL, unsigned long every = 1):
+    vio(vio), mode(mode), every(every ? every : 1), recnum(0), runlen(0),
+    nextemit(0), haslast(false), bin(NULL) {};
+  ~emitter();
+  void setMode(int mymode, unsigned long myevery);
+  // Write binary output with the given column mask, see binout.h.
+  // Every mode but all adds the record column.
+  void setBinary(unsigned int columns);
+  bool binary() const;
+  // Count one record at input time now, true if its median is needed
+  bool due(time_t now);
+  void put(unsigned int med2);
+  // Same for several columns of formatted medians in one line
+  void putText(const std::string& text);
+  // Median with edge and node counts and epoch time, for binary output;
+  // same as put for text output
+  void putRow(unsigned int med2, unsigned int edges, unsigned int nodes,
+              time_t epoch);
+  // Flush pending run and start over, e.g. before switching output files
+  void finish();
+  // Go on where other stopped, with its mode, record count and pending
+  // run, when another engine takes over the output. Text output only.
+  void resume(const emitter& other);
+
+  // "N.00" or "N.50" as in the original output
+  static std::string format(unsigned int med2);
+  // Parse "all", "change", "every:N", "seconds:T" or "rle"
+  static bool parseMode(const char* spec, int& mode, unsigned long& every);
+};
+
+#endif
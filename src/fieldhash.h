@@ -0,0 +1,73 @@
+#ifndef FIELDHASH_H
+#define FIELDHASH_H
+#include <cstddef>
+#include <cstring>      // strncmp
+
+// Perfect hash of the Json keys the wide record parser projects into
+// venmodata, built by the compiler: FNV-1a as in hashtable.cpp, with
+// the offset basis as seed, and the first seed for which no two keys
+// share a slot. Unknown keys are rejected by one comparison with the
+// only key of their slot.
+namespace fieldhash {
+  // Projected keys, in the order of venmodata::Names, then the optional
+  // numeric amount
+  constexpr const char* keys[] = {"created_time", "actor", "target",
+    "amount"};
+  constexpr int amount = 3;
+  constexpr unsigned int nkeys = sizeof(keys) / sizeof(keys[0]);
+  // Table slots, a power of two
+  constexpr unsigned int nslots = 8;
+
+  constexpr unsigned int hash(const char* str, unsigned int seed) {
+    return '\0' == *str ? seed :
+      hash(str + 1, (seed ^ (unsigned char)*str) * 16777619U);
+  }
+
+  constexpr unsigned int slot(unsigned int key, unsigned int seed) {
+    return hash(keys[key], seed) & (nslots - 1);
+  }
+
+  // Whether any pair of keys from (first, second) on shares a slot
+  constexpr bool collides(unsigned int seed, unsigned int first,
+                          unsigned int second) {
+    return first >= nkeys ? false :
+      second >= nkeys ? collides(seed, first + 1, first + 2) :
+      slot(first, seed) == slot(second, seed)
+        || collides(seed, first, second + 1);
+  }
+
+  constexpr unsigned int findSeed(unsigned int seed, unsigned int tries) {
+    return 0 == tries || ! collides(seed, 0, 1) ? seed :
+      findSeed(seed + 1, tries - 1);
+  }
+
+  constexpr unsigned int seed = findSeed(2166136261U, 256);
+  static_assert(! collides(seed, 0, 1), "no perfect hash for the keys");
+
+  // Key in slot, -1 if none
+  constexpr int keyIn(unsigned int myslot, unsigned int key = 0) {
+    return key >= nkeys ? -1 :
+      slot(key, seed) == myslot ? (int)key : keyIn(myslot, key + 1);
+  }
+
+  static_assert(8 == nslots, "table below lists one entry per slot");
+  constexpr int table[nslots] = {keyIn(0), keyIn(1), keyIn(2), keyIn(3),
+    keyIn(4), keyIn(5), keyIn(6), keyIn(7)};
+
+  // Index in keys of the len bytes at str, -1 if not projected
+  inline int lookup(const char* str, std::size_t len) {
+    unsigned int myhash = seed;
+    for(std::size_t ii = 0; ii < len; ii++) {
+      myhash = (myhash ^ (unsigned char)str[ii]) * 16777619U;
+    }
+    int key = table[myhash & (nslots - 1)];
+    // strncmp stops at the end of the shorter key
+    if( key < 0 || 0 != strncmp(keys[key], str, len)
+        || '\0' != keys[key][len] ) {
+      return -1;
+    }
+    return key;
+  }
+}
+
+#endif
@@ -1,13 +1,18 @@
-#include <iostream>      // std::cout
+#include <iostream>      // std::cout, std::cerr
 #include <sstream>       // std::ostringstream
 #include <cassert>       // assert
 #include <climits>       // std::cout
+#include <vector>
+#include <unordered_map>
+#include <malloc.h>      // malloc_trim
 #include "stringutils.h"
 #include "epochtime.h"
 #include "venmodata.h"
 #include "venmoio.h"
 #include "hashtable.h"
 #include "graph.h"
+#include "approxgraph.h"
+#include "probes.h"
 
 inline std::string Node::getStr() const {
   return str;
@@ -17,6 +22,14 @@ inline uint Node::getDeg() const {
   return deg;
 }
 
+inline uint Node::getCid() const {
+  return cid;
+}
+
+inline void Node::putCid(uint mycid) {
+  cid = mycid;
+}
+
 inline void Node::incDeg() {
   ++deg;
 }
@@ -30,6 +43,39 @@ inline int Node::compare(Content* content) const {
   return str.compare(node->getStr());
 }
 
+std::size_t Node::nameBytes() const {
+  const char* data = str.data();
+  const char* self = reinterpret_cast<const char*>(&str);
+  if( data >= self && data < self + sizeof(str) ) {
+    return 0;
+  }
+  return str.capacity() + 1;
+}
+
+inline void Node::linkAdjacent(AdjLink* link) {
+  link->prev = NULL;
+  link->next = adjhead;
+  if( NULL != adjhead ) {
+    adjhead->prev = link;
+  }
+  adjhead = link;
+}
+
+inline void Node::unlinkAdjacent(AdjLink* link) {
+  if( NULL == link->prev ) {
+    adjhead = link->next;
+  } else {
+    link->prev->next = link->next;
+  }
+  if( NULL != link->next ) {
+    link->next->prev = link->prev;
+  }
+}
+
+inline const AdjLink* Node::firstAdjacent() const {
+  return adjhead;
+}
+
 inline Node* Edge::getNode(int index) const {
   return nodes[index];
 }
@@ -38,6 +84,10 @@ inline void Edge::putNode(Node* node, int index) {
   nodes[index] = node;
 }
 
+inline AdjLink* Edge::getLink(int index) {
+  return &adj[index];
+}
+
 inline int Edge::compare(Content* content) const {
   Edge* edge = dynamic_cast<Edge*>(content);
   int comp1 = nodes[0]->getStr().compare(edge->nodes[0]->getStr());
@@ -56,11 +106,30 @@ Graph::~Graph() {
   delete [] degrees;
   delete etab;
   delete ntab;
+  delete hubs;
+  delete conn;
+  delete reclaim;
+  delete budget;
+  delete fallback;
+  delete amounts;
+}
+
+// Free now, or hand over to the background thread
+void Graph::dispose(Content* content) {
+  if( NULL == reclaim ) {
+    delete content;
+  } else {
+    reclaim->retire(content);
+  }
 }
 
-// decrement and increment maximum detected node degree
+// decrement and increment maximum detected node degree. Never below 1:
+// new nodes enter at degree 1 without checking maxdeg, e.g. when a
+// repeated edge was the only one left and is evicted and reinserted.
 inline void Graph::decMaxdeg() {
-  maxdeg--;
+  if( maxdeg > 1 ) {
+    maxdeg--;
+  }
 }
 
 void Graph::incMaxdeg() {
@@ -82,17 +151,78 @@ void Graph::incMaxdeg() {
     }
     delete [] degrees;
     degrees = temp;
+    degsize = newdegsize;
+  }
+}
+
+void Graph::hashRecord(const venmodata* vdt, batchhash& bh) const {
+  bh.vdt = vdt;
+  bh.ehash = htb::mkhash2(vdt->actor, vdt->target);
+  bh.nhash[0] = htb::mkhash1(vdt->actor);
+  bh.nhash[1] = htb::mkhash1(vdt->target);
+}
+
+// Each stage runs over the whole batch before the next one starts, so
+// the loads of one stage are in flight together and have arrived by
+// the time the next stage follows the pointers they brought in.
+// evictEdge looks for the edge in every second, so all per-second
+// tables get prefetched.
+void Graph::prefetchBatch(venmodata* vdts, std::size_t count) {
+  batch.resize(count);
+  batchpos = 0;
+  for(std::size_t ii = 0; ii < count; ii++) {
+    hashRecord(&vdts[ii], batch[ii]);
+  }
+  for(int stage = 0; stage < 3; stage++) {
+    for(std::size_t ii = 0; ii < count; ii++) {
+      for(int jj = 0; jj < EN; jj++) {
+        hashtype nhash = batch[ii].nhash[jj];
+        switch( stage ) {
+          case 0: ntab->prefetchSlot(nhash); break;
+          case 1: ntab->prefetchList(nhash); break;
+          default: ntab->prefetchContent(nhash);
+        }
+      }
+      for(uint sec = 0; sec < MAXSEC; sec++) {
+        Hashtable* mysectab = static_cast<Hashtable*>(etab->getContent(sec));
+        if( NULL != mysectab ) {
+          hashtype ehash = batch[ii].ehash;
+          switch( stage ) {
+            case 0: mysectab->prefetchSlot(ehash); break;
+            case 1: mysectab->prefetchList(ehash); break;
+            default: mysectab->prefetchContent(ehash);
+          }
+        }
+      }
+    }
   }
 }
 
 // Processing of incoming transaction data
 void Graph::process(venmodata* vdt) {
+  if( NULL != fallback ) {
+    fallback->process(vdt);
+    return;
+  }
+  // hashes computed by prefetchBatch, or now if record was not announced
+  batchhash bh;
+  if( batchpos < batch.size() && vdt == batch[batchpos].vdt ) {
+    bh = batch[batchpos++];
+    if( batchpos == batch.size() ) {
+      // done with batch, its record buffer may get reused
+      batch.clear();
+      batchpos = 0;
+    }
+  } else {
+    hashRecord(vdt, bh);
+  }
   // create objects and update data structures
   time_t timediff = vdt->epochtime - currtime;
   // Ignore MAXSEC and larger difference in the past direction
   // to keep only seconds within one minute
   if( timediff <= -MAXSEC ) {
     // new data is too old to insert, ignore
+    PROBE1(record_rejected, "late");
     return;
   }
   if( timediff > 0) {
@@ -119,19 +249,22 @@ void Graph::process(venmodata* vdt) {
       }
 //       std::cout << "Calling evictSectab from " << currsec
 //       << " to " << vdt->sec << " aka " << newsec << std::endl;
-      for( uint index = currsec + 1; index <= newsec; index++ ) {
-        evictSectab(index % MAXSEC);
-      }
+      evictSectabs(currsec + 1, newsec - currsec);
     }
     // new data estabishes new, more recent, current time
     currtime = vdt->epochtime;
     currsec = vdt->sec;
   }
-  hashtype ehash = htb::mkhash2(vdt->actor, vdt->target);
   Node* mynode[EN] = {new Node(vdt->actor), new Node(vdt->target)};
   Edge* myedge = new Edge(mynode[0], mynode[1]);
 //   std::cout << "Inserting at hash " << ehash << std::endl;
-  insertEdge(myedge, vdt->sec, ehash);
+  insertEdge(myedge, vdt->sec, bh.ehash, bh.nhash);
+  if( NULL != amounts && vdt->NOAMOUNT != vdt->amount ) {
+    amounts->add(vdt->sec, vdt->amount);
+  }
+  if( (NULL != budget || NULL != snapshot) && 0 == ++memcount % MEMCHECK ) {
+    checkMemory();
+  }
 
   // test output
 //   Hashtable* mysectab =
@@ -148,12 +281,14 @@ void Graph::process(venmodata* vdt) {
 // Node must exist!!!
 void Graph::evictExistingNode(Node* node) {
   hashtype nhash = htb::mkhash1(node->getStr());
-  List* mylist = dynamic_cast<List*>(ntab->getContent(nhash));
-  assert( NULL != mylist );
-  List* beflist = mylist->findBef(node);
+  assert( NULL != ntab->getContent(nhash) );
+  List* beflist = ntab->findBef(node, nhash);
   assert( NULL != beflist );
   assert( 0 == node->compare(beflist->getContent()) );
-  ntab->evictListitem(beflist, nhash);
+  ntab->unlinkListitem(beflist, nhash);
+  namebytes -= node->nameBytes();
+  dispose(beflist->getContent());
+  dispose(beflist);
 }
 
 void Graph::reduceEdgeNodes(Edge* edge) {
@@ -164,6 +299,12 @@ void Graph::reduceEdgeNodes(Edge* edge) {
 //   << myedge->getNode(1)->getDeg() << "), "
 //   << "at " << mysec << " secs, hash " << ehash << std::endl;
   uint mydeg;
+  if( adjacency ) {
+    unlinkEdge(edge);
+  }
+  if( NULL != conn ) {
+    conn->removeEdge(edge->getNode(0)->getCid(), edge->getNode(1)->getCid());
+  }
   for(int ii = 0; ii < EN; ii++) {
     mydeg = edge->getNode(ii)->getDeg();
     degrees[mydeg]--;
@@ -171,9 +312,15 @@ void Graph::reduceEdgeNodes(Edge* edge) {
       decMaxdeg();
     }
     edge->getNode(ii)->decDeg();
+    if( NULL != hubs ) {
+      hubs->moveDown(edge->getNode(ii), mydeg);
+    }
     mydeg = edge->getNode(ii)->getDeg();
     // If node degree reaches zero, evict it, else update degrees
     if( 0 == mydeg ) {
+      if( NULL != conn ) {
+        conn->removeVertex(edge->getNode(ii)->getCid());
+      }
       evictExistingNode(edge->getNode(ii));
     } else {
       degrees[edge->getNode(ii)->getDeg()]++;
@@ -182,8 +329,9 @@ void Graph::reduceEdgeNodes(Edge* edge) {
 }
 
 // Evict from database one edge that matches edge passed as parameter
-// Matching edge needs not exist but at most one may exist
-void Graph::evictEdge(Edge* myedge, hashtype ehash) {
+// Matching edge needs not exist but at most one may exist, returns
+// whether one was found
+bool Graph::evictEdge(Edge* myedge, hashtype ehash) {
 
   // check if this hash/names exist at ANY PREVIOUS second
   // At every != check we can abort, gaining efficiency
@@ -193,67 +341,136 @@ void Graph::evictEdge(Edge* myedge, hashtype ehash) {
     Hashtable* mysectab = dynamic_cast<Hashtable*>(etab->getContent(mysec));
     if( NULL != mysectab ) {
       // Does the tab at the older second have data at this hash?
-      List* mylist = dynamic_cast<List*>(mysectab->getContent(ehash));
-      if( NULL != mylist ) {
+      if( NULL != mysectab->getContent(ehash) ) {
         // Are there items that are smaller or equal to our item?
-        List* beflist = mylist->findBef(myedge);
+        List* beflist = mysectab->findBef(myedge, ehash);
         if( NULL != beflist ) {
           // Is it a match?
           if( 0 == myedge->compare(beflist->getContent()) ) {
-            // Evict this edge
+            // Evict this edge, unlinked while its nodes still exist, as
+            // a bucket tree compares the edge's names
             edgenum--;
+            mysectab->unlinkListitem(beflist, ehash);
             reduceEdgeNodes( dynamic_cast<Edge*>(beflist->getContent()) );
-            mysectab->evictListitem(beflist, ehash);
+            dispose(beflist->getContent());
+            dispose(beflist);
             // At most one match in database, so exit function here
-            return;
+            return true;
           }
         }
       }
     }
   }
-
+  return false;
 }
 
 // Evict from database entire second edge database and reduceEdgeNodes
 // This is faster than evicting edges individually, as we don't need to
 // maintain valid linked lists
 void Graph::evictSectab(uint sec) {
+  evictSectabs(sec, 1);
+}
 
-  Hashtable* mysectab = dynamic_cast<Hashtable*>(etab->getContent(sec));
-  if( NULL == mysectab ) {
-    // Nothing to do
-    return;
-  }
-  for(hashtype hash = 0; hash <= htb::hashmask2; hash++) {
-    // Does the tab at have data at this hash?
-    List* mylist = dynamic_cast<List*>(mysectab->getContent(hash));
-    // Iterate over list items
-    while( NULL != mylist ) {
-      // Evict this edge
-      edgenum--;
-      Edge* myedge = dynamic_cast<Edge*>(mylist->getContent());
-      reduceEdgeNodes( myedge );
-      delete myedge;
+// Two passes: the first drops the edges of all seconds and only counts
+// for each end node how many of its edges went, the second moves every
+// such node once from its old to its new degree. A hub with thousands
+// of edges in the expiring seconds thus costs one histogram move, and
+// maxdeg is recomputed once at the end. The hub index also moves each
+// such node once.
+void Graph::evictSectabs(uint first, uint count) {
+  for(uint index = first; index < first + count; index++) {
+    uint sec = index % MAXSEC;
+    if( NULL != amounts ) {
+      amounts->evictSecond(sec);
+    }
+    Hashtable* mysectab = dynamic_cast<Hashtable*>(etab->getContent(sec));
+    if( NULL == mysectab ) {
+      // Nothing to do
+      continue;
+    }
+    PROBEVAR(uint before = edgenum;)
+    for(hashtype hash = 0; hash <= htb::hashmask2; hash++) {
+      // Does the tab at have data at this hash?
+      List* mylist = dynamic_cast<List*>(mysectab->getContent(hash));
+      // Iterate over list items
+      while( NULL != mylist ) {
+        // Evict this edge, its nodes only note the decrement
+        edgenum--;
+        Edge* myedge = dynamic_cast<Edge*>(mylist->getContent());
+        if( adjacency ) {
+          unlinkEdge(myedge);
+        }
+        if( NULL != conn ) {
+          conn->removeEdge(myedge->getNode(0)->getCid(),
+                           myedge->getNode(1)->getCid());
+        }
+        for(int ii = 0; ii < EN; ii++) {
+          Node* mynode = myedge->getNode(ii);
+          if( 0 == mynode->pending++ ) {
+            touched.push_back(mynode);
+          }
+        }
+        dispose(myedge);
 
-      List* newlist = mylist->getNext();
-      delete mylist;
-      mylist = newlist;
+        List* newlist = mylist->getNext();
+        dispose(mylist);
+        mylist = newlist;
+      }
     }
-    // May overwrite list pointer in hash table to NULL but will be deleted
-    // mysectab->putContent(NULL, hash);
+    // delete and evict whole sectab from etab hash table, its lists are
+    // gone already
+    dispose(mysectab);
+    etab->putContent(NULL, sec);
+    PROBE2(second_evicted, sec, before - edgenum);
   }
-  // delete and evict whole sectab from etab hash table
-  delete mysectab;
-  etab->putContent(NULL, sec);
 
+  for(std::size_t ii = 0; ii < touched.size(); ii++) {
+    Node* mynode = touched[ii];
+    uint olddeg = mynode->deg;
+    uint newdeg = olddeg - mynode->pending;
+    mynode->pending = 0;
+    degrees[olddeg]--;
+    if( NULL != hubs ) {
+      hubs->move(mynode, olddeg, newdeg);
+    }
+    mynode->deg = newdeg;
+    // If node degree reaches zero, evict it, else update degrees
+    if( 0 == newdeg ) {
+      if( NULL != conn ) {
+        conn->removeVertex(mynode->getCid());
+      }
+      evictExistingNode(mynode);
+    } else {
+      degrees[newdeg]++;
+    }
+  }
+  touched.clear();
+  while( maxdeg > 1 && 0 == degrees[maxdeg] ) {
+    maxdeg--;
+  }
 }
 
 // Evict from database entire database including edges
 // This is faster than evicting edges individually, as we don't need to
 // maintain valid linked lists and node data
 void Graph::evictAll() {
-  // Delete all nodes independently of edges
-  for(hashtype hash = 0; hash <= htb::hashmask1; hash++) {
+  PROBE1(evict_all, edgenum);
+  if( NULL != reclaim ) {
+    // hand over whole tables, the background thread walks them, so
+    // only the tables' pointers are touched here
+    reclaim->retire(ntab, true, 2 * (nodeCount() + edgenum) + 1);
+    ntab = new Hashtable(htb::hashmask1 + 1);
+    for(uint sec = 0; sec < MAXSEC; sec++) {
+      Content* mysectab = etab->getContent(sec);
+      if( NULL != mysectab ) {
+        reclaim->retire(mysectab, true);
+        etab->putContent(NULL, sec);
+      }
+    }
+  }
+  // Delete all nodes independently of edges, nothing left to do here
+  // if tables were handed over
+  for(hashtype hash = 0; NULL == reclaim && hash <= htb::hashmask1; hash++) {
     // Does the tab at have data at this hash?
     List* mylist = dynamic_cast<List*>(ntab->getContent(hash));
     // Iterate over list items
@@ -293,6 +510,16 @@ void Graph::evictAll() {
     }
   }
   edgenum = 0;
+  namebytes = 0;
+  if( NULL != amounts ) {
+    amounts->clear();
+  }
+  if( NULL != hubs ) {
+    hubs->clear();
+  }
+  if( NULL != conn ) {
+    conn->clear();
+  }
   // Reset degree data and maxdeg
   for(uint deg = 0; deg <= maxdeg; deg++) {
     degrees[deg] = 0;
@@ -307,15 +534,25 @@ void Graph::evictAll() {
 // a second level hash table), and pass on insertion task to second level
 // function Hashtable::insertListContent
 void Graph::insertEdge(Edge* myedge, uint sec, hashtype ehash) {
+  hashtype nhash[EN];
+  for(int ii = 0; ii < EN; ii++) {
+    nhash[ii] = htb::mkhash1( myedge->getNode(ii)->getStr() );
+  }
+  insertEdge(myedge, sec, ehash, nhash);
+}
 
-  evictEdge(myedge, ehash);
+// Same with node hashes known in advance
+void Graph::insertEdge(Edge* myedge, uint sec, hashtype ehash,
+                       const hashtype* nhash) {
+
+  PROBEVAR(bool refreshed =) evictEdge(myedge, ehash);
 //   std::cout << "State after evicting existing:" << std::endl;
 //   test_output();
 
   // Insert nodes and check if they pre-existed
   for(int ii = 0; ii < EN; ii++) {
     Node* resnode = dynamic_cast<Node*>( ntab->insertListContent(
-      myedge->getNode(ii), htb::mkhash1( myedge->getNode(ii)->getStr() ) ) );
+      myedge->getNode(ii), nhash[ii] ) );
     // If name matches, existing node is returned and fresh node is deleted
     if( myedge->getNode(ii) != resnode ) {
       myedge->putNode(resnode, ii);
@@ -325,6 +562,9 @@ void Graph::insertEdge(Edge* myedge, uint sec, hashtype ehash) {
       degrees[resnode->getDeg()]--;
       // increment degree
       resnode->incDeg();
+      if( NULL != hubs ) {
+        hubs->moveUp(resnode, resnode->getDeg() - 1);
+      }
       // increment new degree list occupation
       degrees[resnode->getDeg()]++;
       // increment max degree if needed
@@ -336,8 +576,21 @@ void Graph::insertEdge(Edge* myedge, uint sec, hashtype ehash) {
     } else {
       // we inserted a new node, increase number of deg 1 nodes
       degrees[1]++;
+      namebytes += resnode->nameBytes();
+      if( NULL != hubs ) {
+        hubs->add(resnode);
+      }
+      if( NULL != conn ) {
+        resnode->putCid(conn->addVertex());
+      }
     }
   }
+  if( NULL != conn ) {
+    conn->addEdge(myedge->getNode(0)->getCid(), myedge->getNode(1)->getCid());
+  }
+  if( adjacency ) {
+    linkEdge(myedge);
+  }
 //   std::cout << "Updated myedge "
 //     << myedge->getNode(0)->getStr() << "("
 //     << myedge->getNode(0)->getDeg() << "), "
@@ -371,10 +624,11 @@ void Graph::insertEdge(Edge* myedge, uint sec, hashtype ehash) {
 //       << std::endl;
 
   }
+  PROBE2(edge_inserted, sec, refreshed);
 }
 
-// Output statistics on number of degrees
-void Graph::output() {
+// Twice the median degree, an integer as degrees are integers
+uint Graph::median2() const {
   assert( 0 == degrees[0] );
 
   // Collect the sum of occupation numbers of degrees,
@@ -395,10 +649,387 @@ void Graph::output() {
   }
 
   // If we broke at exactly half sum, we are between occupation numbers,
-  // so print (ii).50, otherwise we are beyond half, print (ii).00
+  // so median is (ii).50, otherwise we are beyond half, (ii).00
+  return 2*ii + ((sum2 > sum) ? 0 : 1);
+}
+
+// Output statistics on number of degrees. The median is only computed
+// if the output mode is going to write something for this record, or
+// a snapshot is published.
+void Graph::output() {
+  if( NULL != fallback ) {
+    fallback->output();
+    if( NULL != snapshot ) {
+      snapshot->publish(fallback->median2(), fallback->trackedNodes(), 0, 0,
+        currtime, membytes);
+    }
+    return;
+  }
+#ifndef NDEBUG
+  if( NULL != conn && 0 == ++checkcount % CONNCHECK ) {
+    checkComponents();
+  }
+#endif
+  if( NULL != queries && queries->waiting() ) {
+    std::string request;
+    if( queries->take(request) ) {
+      queries->reply(answerQuery(request));
+    }
+  }
+  bool due = emit.due(currtime);
+  if( ! due && NULL == snapshot ) {
+    return;
+  }
+  uint med2 = median2();
+  if( NULL != snapshot ) {
+    snapshot->publish(med2, nodeCount(), edgenum, maxdeg, currtime,
+      membytes);
+  }
+  if( due ) {
+    PROBE2(median_emitted, med2, currtime);
+    if( emit.binary() ) {
+      emit.putRow(med2, edgenum, nodeCount(), currtime);
+    } else if( NULL == conn && NULL == amounts ) {
+      emit.put(med2);
+    } else {
+      std::ostringstream outstr;
+      outstr << emitter::format(med2);
+      if( NULL != conn ) {
+        outstr << " " << conn->components() << " " << conn->largest();
+      }
+      for(std::size_t ii = 0; NULL != amounts && ii < quantiles.size();
+          ii++) {
+        outstr << " " << AmountWindow::format(
+          amounts->quantile(quantiles[ii]));
+      }
+      emit.putText(outstr.str());
+    }
+  }
+}
+
+// Nodes in window, from degree occupations
+uint Graph::nodeCount() const {
+  uint count = 0;
+  for(uint ii = 1; ii <= maxdeg; ii++) {
+    count += degrees[ii];
+  }
+  return count;
+}
+
+void Graph::setOutputFormat(unsigned int columns) {
+  emit.setBinary(columns);
+}
+
+// Select which medians output writes, see emitter.h
+void Graph::setOutputMode(int mode, unsigned long every) {
+  emit.setMode(mode, every);
+}
+
+// Write pending output, e.g. the last run of run length encoded medians
+void Graph::finishOutput() {
+  if( NULL != fallback ) {
+    fallback->finishOutput();
+  } else {
+    emit.finish();
+  }
+}
+
+void Graph::trackHubs() {
+  if( NULL == hubs ) {
+    hubs = new HubIndex();
+  }
+}
+
+void Graph::topHubs(uint k, std::vector<Node*>& out) const {
+  out.clear();
+  if( NULL != hubs ) {
+    hubs->topNodes(k, out);
+  }
+}
+
+void Graph::publishStats(StatsSnapshot* mysnapshot) {
+  snapshot = mysnapshot;
+}
+
+void Graph::reclaimMemory(std::size_t limit) {
+  if( NULL == reclaim ) {
+    reclaim = new Reclaimer(limit);
+  }
+}
+
+std::size_t Graph::reclaimHighWater() const {
+  return (NULL == reclaim) ? 0 : reclaim->highWater();
+}
+
+// Each end of the edge goes to the front of its node's list, an edge
+// to itself into the same list twice
+void Graph::linkEdge(Edge* edge) {
+  for(int ii = 0; ii < EN; ii++) {
+    AdjLink* link = edge->getLink(ii);
+    link->other = edge->getNode(EN - 1 - ii);
+    edge->getNode(ii)->linkAdjacent(link);
+  }
+}
+
+void Graph::unlinkEdge(Edge* edge) {
+  for(int ii = 0; ii < EN; ii++) {
+    edge->getNode(ii)->unlinkAdjacent(edge->getLink(ii));
+  }
+}
+
+// Nodes only hold adjacency of edges inserted from now on, so this must
+// come before the first edge
+void Graph::trackNeighbors() {
+  adjacency = true;
+}
+
+Node* Graph::findNode(const std::string& name) const {
+  hashtype nhash = htb::mkhash1(name);
+  Node probe(name);
+  List* beflist = ntab->findBef(&probe, nhash);
+  if( NULL != beflist && 0 == probe.compare(beflist->getContent()) ) {
+    return static_cast<Node*>(beflist->getContent());
+  }
+  return NULL;
+}
+
+void Graph::neighbors(const Node* node, std::vector<Node*>& out) const {
+  if( ! adjacency ) {
+    return;
+  }
+  for(const AdjLink* link = node->firstAdjacent(); NULL != link;
+      link = link->next) {
+    out.push_back(link->other);
+  }
+}
+
+void Graph::answerQueries(QueryBox* box) {
+  queries = box;
+}
+
+std::string Graph::answerQuery(const std::string& request) const {
+  std::size_t space = request.find(' ');
+  std::string verb = request.substr(0, space);
+  std::string name = (std::string::npos == space) ? "" :
+    stu::trim(request.substr(space + 1));
+  if( name.empty() || ("degree" != verb && "neighbors" != verb) ) {
+    return "error expected degree <name> or neighbors <name>\n";
+  }
+  Node* node = findNode(name);
   std::ostringstream outstr;
-  outstr << ii << "." << ((sum2 > sum) ? "0" : "5") << "0" << std::endl;
-  vio->outStr(outstr.str());
+  outstr << ((NULL == node) ? 0 : node->getDeg()) << "\n";
+  if( "neighbors" == verb && NULL != node ) {
+    std::vector<Node*> adjacent;
+    neighbors(node, adjacent);
+    for(std::size_t ii = 0; ii < adjacent.size(); ii++) {
+      outstr << adjacent[ii]->getStr() << "\n";
+    }
+  }
+  return outstr.str();
+}
+
+void Graph::trackComponents() {
+  if( NULL == conn ) {
+    conn = new DynConn();
+  }
+}
+
+void Graph::checkComponents() const {
+  if( NULL == conn ) {
+    return;
+  }
+  // number nodes, then collect adjacency from all per second tables
+  std::unordered_map<Node*, uint> index;
+  for(hashtype hash = 0; hash <= htb::hashmask1; hash++) {
+    for(List* mylist = dynamic_cast<List*>(ntab->getContent(hash));
+        NULL != mylist; mylist = mylist->getNext()) {
+      uint next = index.size();
+      index[dynamic_cast<Node*>(mylist->getContent())] = next;
+    }
+  }
+  std::vector< std::vector<uint> > adjacent(index.size());
+  for(uint sec = 0; sec < MAXSEC; sec++) {
+    Hashtable* mysectab = dynamic_cast<Hashtable*>(etab->getContent(sec));
+    if( NULL == mysectab ) {
+      continue;
+    }
+    for(hashtype hash = 0; hash <= htb::hashmask2; hash++) {
+      for(List* mylist = dynamic_cast<List*>(mysectab->getContent(hash));
+          NULL != mylist; mylist = mylist->getNext()) {
+        Edge* myedge = dynamic_cast<Edge*>(mylist->getContent());
+        uint ends[EN];
+        for(int ii = 0; ii < EN; ii++) {
+          ends[ii] = index[myedge->getNode(ii)];
+        }
+        adjacent[ends[0]].push_back(ends[1]);
+        adjacent[ends[1]].push_back(ends[0]);
+      }
+    }
+  }
+  // breadth first search from every node not reached yet
+  std::vector<bool> seen(index.size(), false);
+  std::vector<uint> queue;
+  uint count = 0, largest = 0;
+  for(uint start = 0; start < index.size(); start++) {
+    if( seen[start] ) {
+      continue;
+    }
+    count++;
+    queue.assign(1, start);
+    seen[start] = true;
+    for(std::size_t head = 0; head < queue.size(); head++) {
+      for(std::size_t ii = 0; ii < adjacent[queue[head]].size(); ii++) {
+        uint next = adjacent[queue[head]][ii];
+        if( ! seen[next] ) {
+          seen[next] = true;
+          queue.push_back(next);
+        }
+      }
+    }
+    if( queue.size() > largest ) {
+      largest = queue.size();
+    }
+  }
+  if( count != conn->components() || largest != conn->largest() ) {
+    stu::abortf("Component check failed: %u components, largest %u, "
+      "tracked %u, largest %u\n", count, largest, conn->components(),
+      conn->largest());
+  }
+}
+
+// Sizes of the objects in the window. Every node and edge sits in one
+// list item of its table, and every edge in one of the per second
+// tables.
+memusage Graph::memory() const {
+  memusage use;
+  uint nodes = nodeCount();
+  use.nodes = nodes * sizeof(Node) + namebytes;
+  use.edges = edgenum * sizeof(Edge);
+  use.lists = (std::size_t)(nodes + edgenum) * sizeof(List);
+  use.tables = sizeof(Graph) + etab->tableBytes() + ntab->tableBytes();
+  use.trees = ntab->treeBytes();
+  for(uint sec = 0; sec < MAXSEC; sec++) {
+    Hashtable* mysectab = static_cast<Hashtable*>(etab->getContent(sec));
+    if( NULL != mysectab ) {
+      use.tables += mysectab->tableBytes();
+      use.trees += mysectab->treeBytes();
+    }
+  }
+  use.histograms = degsize * sizeof(uint);
+  if( NULL != hubs ) {
+    use.histograms += hubs->bytes();
+  }
+  if( NULL != amounts ) {
+    use.amounts = amounts->bytes();
+  }
+  if( NULL != conn ) {
+    use.components = conn->bytes();
+  }
+  if( NULL != reclaim ) {
+    use.pending = reclaim->waiting() * (sizeof(Edge) + sizeof(List));
+  }
+  use.buffers = batch.capacity() * sizeof(batchhash)
+    + touched.capacity() * sizeof(Node*);
+  return use;
+}
+
+void Graph::limitMemory(std::size_t bytes, int action) {
+  delete budget;
+  budget = new MemoryBudget(bytes, action);
+}
+
+const MemoryBudget* Graph::memoryBudget() const {
+  return budget;
+}
+
+const ApproxGraph* Graph::approximation() const {
+  return fallback;
+}
+
+void Graph::trackAmounts(const std::vector<double>& qs) {
+  if( NULL == amounts ) {
+    amounts = new AmountWindow();
+  }
+  quantiles = qs;
+  vio->setAmounts(true);
+}
+
+long long Graph::amountQuantile(double q) const {
+  return (NULL == amounts) ? 0 : amounts->quantile(q);
+}
+
+// Count the bytes in use, for the snapshot and against the budget
+void Graph::checkMemory() {
+  membytes = memory().total();
+  if( NULL == budget || ! budget->due(membytes) ) {
+    return;
+  }
+  switch( budget->getAction() ) {
+    case MEM_APPROX:
+      degrade();
+      return;
+    case MEM_COMPACT:
+      compact();
+      membytes = memory().total();
+      if( ! budget->near(membytes) ) {
+        return;
+      }
+      break;
+  }
+  std::cerr << "memory: window holds " << (membytes >> 10) << " KiB of "
+    << (budget->getBudget() >> 10) << " KiB budget at time " << currtime
+    << std::endl;
+}
+
+// Give back what the window no longer needs: the degree histogram down
+// to the smallest power of two above maxdeg, and free heap pages to the
+// system
+void Graph::compact() {
+  uint newdegsize = 2048;
+  while( newdegsize <= maxdeg + 1 ) {
+    newdegsize <<= 1;
+  }
+  if( newdegsize < degsize ) {
+    uint* temp = new uint[newdegsize]();
+    for(uint ii = 0; ii <= maxdeg; ii++) {
+      temp[ii] = degrees[ii];
+    }
+    delete [] degrees;
+    degrees = temp;
+    degsize = newdegsize;
+  }
+  malloc_trim(0);
+}
+
+// Hand the window to the approximate engine: replay its edges oldest
+// second first, each at the time of its second, then drop the exact
+// window. The output goes on where this engine stopped.
+void Graph::degrade() {
+  fallback = new ApproxGraph(vio, MAXSEC, budget->getBudget() / APPROXENTRY);
+  fallback->resumeOutput(emit);
+  for(uint ii = 1; ii <= MAXSEC; ii++) {
+    uint sec = (currsec + ii) % MAXSEC;
+    Hashtable* mysectab = dynamic_cast<Hashtable*>(etab->getContent(sec));
+    if( NULL == mysectab ) {
+      continue;
+    }
+    venmodata vdt("", "", "", currtime - (MAXSEC - ii), sec);
+    for(hashtype hash = 0; hash <= htb::hashmask2; hash++) {
+      for(List* mylist = dynamic_cast<List*>(mysectab->getContent(hash));
+          NULL != mylist; mylist = mylist->getNext()) {
+        Edge* myedge = dynamic_cast<Edge*>(mylist->getContent());
+        vdt.actor = myedge->getNode(0)->getStr();
+        vdt.target = myedge->getNode(1)->getStr();
+        fallback->process(&vdt);
+      }
+    }
+  }
+  std::cerr << "memory: window of " << edgenum << " edges holds "
+    << (membytes >> 10) << " KiB of " << (budget->getBudget() >> 10)
+    << " KiB budget at time " << currtime << ", continuing approximately"
+    << std::endl;
+  evictAll();
+  membytes = 0;
 }
 
 // Unit testing output function follows
@@ -1,29 +1,73 @@
 #ifndef PROCESS_H
 #define PROCESS_H
+#include <vector>
 #include "epochtime.h"
 #include "venmodata.h"
 #include "venmoio.h"
 #include "hashtable.h"
+#include "emitter.h"
+#include "hubindex.h"
+#include "dynconn.h"
+#include "snapshot.h"
+#include "reclaim.h"
+#include "query.h"
+#include "memory.h"
+#include "amounts.h"
 
 // For convenience
 typedef unsigned int uint;
 
+class Node;
+class ApproxGraph;
+
+// Entry of an edge in the adjacency list of one of its end nodes,
+// pointing at the other end node
+struct AdjLink {
+  Node* other;
+  AdjLink* prev;
+  AdjLink* next;
+};
+
 // node element holding string str for a person's name and node degree
 class Node : public Content {
 protected:
   std::string str;
   uint deg;
+  // vertex id in DynConn, if components are tracked
+  uint cid;
+  // neighbors in HubIndex bucket of same degree, if hubs are tracked
+  Node* hubprev;
+  Node* hubnext;
+  // first edge end at this node, if neighbors are tracked
+  AdjLink* adjhead;
+  // edges of this node in the seconds being evicted, see
+  // Graph::evictSectabs
+  uint pending;
+  friend class HubIndex;
+  friend class Graph;
 public:
   // Initialize new node with degree 1
-  Node(std::string str, uint deg = 1): str(str), deg(deg) {};
+  Node(std::string str, uint deg = 1): str(str), deg(deg), cid(0),
+    hubprev(NULL), hubnext(NULL), adjhead(NULL), pending(0) {};
   virtual std::string getStr() const;
   virtual uint getDeg() const;
+  virtual uint getCid() const;
+  virtual void putCid(uint mycid);
   // increment and decrement degree ??? remove from ntab if zero
   virtual void incDeg();
   virtual void decDeg();
   virtual int compare(Content* content) const;
+  // Heap bytes of the name, 0 if it fits into the string object
+  std::size_t nameBytes() const;
+  // Adjacency list, one entry per edge end at this node
+  void linkAdjacent(AdjLink* link);
+  void unlinkAdjacent(AdjLink* link);
+  const AdjLink* firstAdjacent() const;
 };
 
+// Records between checkComponents calls in debug builds
+#define CONNCHECK 1024
+
 // Nodes per edge = edge nodes EN
 #define EN 2
 
@@ -31,14 +75,24 @@ public:
 class Edge : public Content {
 protected:
   Node* nodes[EN];
+  // entry in adjacency list of each node, if neighbors are tracked
+  AdjLink adj[EN];
 public:
   Edge(Node* actor, Node* target)
     { nodes[0] = actor; nodes[1] = target; };
   virtual Node* getNode(int index) const;
   virtual void putNode(Node* node, int index);
+  AdjLink* getLink(int index);
   virtual int compare(Content* content) const;
 };
 
+// Hashes of one record, computed ahead by Graph::prefetchBatch
+struct batchhash {
+  const venmodata* vdt;
+  hashtype ehash;
+  hashtype nhash[EN];
+};
+
 class Graph {
 protected:
   venmoio* vio;
@@ -47,10 +101,54 @@ protected:
   uint* degrees;
   Hashtable* etab;
   Hashtable* ntab;
+  emitter emit;
+  // Optional index of nodes by degree, NULL unless trackHubs was called
+  HubIndex* hubs;
+  // Records announced by prefetchBatch and the next one due
+  std::vector<batchhash> batch;
+  std::size_t batchpos;
+  void hashRecord(const venmodata* vdt, batchhash& bh) const;
+  // Optional connectivity of the window graph, NULL unless
+  // trackComponents was called
+  DynConn* conn;
+  unsigned long checkcount;
+  // Published after every record if set, not owned
+  StatsSnapshot* snapshot;
+  // Frees evicted objects in the background, NULL unless reclaimMemory
+  // was called, then evictions only unlink
+  Reclaimer* reclaim;
+  void dispose(Content* content);
+  // Adjacency lists of nodes are kept, see trackNeighbors
+  bool adjacency;
+  void linkEdge(Edge* edge);
+  void unlinkEdge(Edge* edge);
+  // Nodes with pending degree decrements during evictSectabs
+  std::vector<Node*> touched;
+  // Answered between records if set, not owned
+  QueryBox* queries;
+  // Heap bytes of the names of the nodes in the window
+  std::size_t namebytes;
+  // Bytes in use are counted every MEMCHECK records if either is set
+  MemoryBudget* budget;
+  unsigned long memcount;
+  std::size_t membytes;
+  // Takes over all records once the budget action approx was due, NULL
+  // before
+  ApproxGraph* fallback;
+  void checkMemory();
+  void compact();
+  void degrade();
+  // Amounts of the window and the quantiles written after each median,
+  // NULL unless trackAmounts was called
+  AmountWindow* amounts;
+  std::vector<double> quantiles;
 
 public:
   Graph(venmoio* vio, time_t currtime = -MAXSEC, int currsec = -1, uint edgenum = 0, uint maxdeg = 1, uint degsize = 2048):
-    vio(vio), currtime(currtime), edgenum(edgenum), currsec(currsec), degsize(degsize), maxdeg(maxdeg) {
+    vio(vio), currtime(currtime), edgenum(edgenum), currsec(currsec), degsize(degsize), maxdeg(maxdeg), emit(vio), hubs(NULL), batchpos(0),
+    conn(NULL), checkcount(0), snapshot(NULL), reclaim(NULL),
+    adjacency(false), queries(NULL), namebytes(0), budget(NULL),
+    memcount(0), membytes(0), fallback(NULL), amounts(NULL) {
     // Edge table indexed by second after the minute, 0 <= sec < MAXSEC
     // Increase to treat leap seconds separately.
     etab = new Hashtable(MAXSEC);
@@ -63,12 +161,76 @@ public:
   virtual void decMaxdeg();
   virtual void evictExistingNode(Node* node);
   virtual void reduceEdgeNodes(Edge* edge);
-  virtual void evictEdge(Edge* myedge, hashtype ehash);
+  virtual bool evictEdge(Edge* myedge, hashtype ehash);
   virtual void evictSectab(uint sec);
+  // Evict count consecutive seconds of the ring from first on, with one
+  // degree histogram move per node whatever its number of edges there
+  virtual void evictSectabs(uint first, uint count);
   virtual void evictAll();
   virtual void insertEdge(Edge* myedge, uint sec, hashtype ehash);
+  virtual void insertEdge(Edge* myedge, uint sec, hashtype ehash,
+                          const hashtype* nhash);
+  // Hash count records and prefetch the node and edge table buckets
+  // they will visit, so that their cache misses overlap. The records
+  // must then be passed to process in the same order, which reuses the
+  // hashes. Prefetching changes no state, so results stay identical.
+  virtual void prefetchBatch(venmodata* vdts, std::size_t count);
   virtual void process(venmodata* vdt);
+  virtual uint median2() const;
+  virtual uint nodeCount() const;
   virtual void output();
+  virtual void setOutputMode(int mode, unsigned long every = 1);
+  // Binary output with column mask of binout.h, 0 for text
+  virtual void setOutputFormat(unsigned int columns);
+  virtual void finishOutput();
+  // Keep nodes indexed by degree for topHubs, call before processing
+  virtual void trackHubs();
+  // Up to k highest degree nodes, highest first, empty if not tracked
+  virtual void topHubs(uint k, std::vector<Node*>& out) const;
+  // Publish median, nodes, edges and maximum degree to snapshot after
+  // every record, for readers on other threads, NULL to stop
+  virtual void publishStats(StatsSnapshot* mysnapshot);
+  // Free evicted nodes, edges, list items and tables on a background
+  // thread, with at most limit objects waiting, call before processing
+  virtual void reclaimMemory(std::size_t limit);
+  // Most objects that waited to be freed at one time, 0 if not reclaimed
+  // in the background
+  virtual std::size_t reclaimHighWater() const;
+  // Keep number of connected components and largest component size,
+  // written after each median, call before processing
+  virtual void trackComponents();
+  // Compare tracked components with a breadth first search over the
+  // edge tables, abort on mismatch. Runs every CONNCHECK records in
+  // builds without NDEBUG.
+  virtual void checkComponents() const;
+  // Keep a list of the edges at each node, linked through the edges, so
+  // neighbors is O(degree). Costs three pointers per edge end, call
+  // before processing.
+  virtual void trackNeighbors();
+  // Node in window by name, NULL if none, O(1) expected
+  virtual Node* findNode(const std::string& name) const;
+  // Append the other end of each edge at node, a neighbor once per edge
+  // between them (twice for an edge to itself), empty if not tracked
+  virtual void neighbors(const Node* node, std::vector<Node*>& out) const;
+  // Answer requests waiting in box after every record, NULL to stop
+  virtual void answerQueries(QueryBox* box);
+  // Answer to "degree <name>": a line with the degree, 0 if not in the
+  // window, or "neighbors <name>": same, then one line per neighbor name
+  virtual std::string answerQuery(const std::string& request) const;
+  // Estimate of the bytes held by the window by kind, O(MAXSEC)
+  virtual memusage memory() const;
+  // Count the bytes in use every MEMCHECK records and take action, see
+  // memory.h, when they near bytes. Call before processing.
+  virtual void limitMemory(std::size_t bytes, int action);
+  // NULL unless limitMemory was called
+  virtual const MemoryBudget* memoryBudget() const;
+  // Engine the window was handed to by the approx action, NULL if none
+  virtual const ApproxGraph* approximation() const;
+  // Keep the amounts of records in the window and write their qs
+  // quantiles after each median, call before processing
+  virtual void trackAmounts(const std::vector<double>& qs);
+  // q quantile of the amounts in the window in cents, 0 if not tracked
+  virtual long long amountQuantile(double q) const;
   virtual void test_output();
 };
 
@@ -0,0 +1,173 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>   // std::shuffle
+#include <cstdlib>      // strtoul
+#include <getopt.h>
+#include "hashtable.h"
+#include "latency.h"
+#include "streamgen.h"
+#include "stringutils.h"
+
+
+// Adversarial benchmark of the node table: names crafted to collide in
+// one bucket under the unkeyed FNV-1a hash the tables used before, put
+// into, looked up in and removed from a table the size of the node
+// table, once with plain bucket lists as before, once with trees for
+// long buckets, and once hashed with the keyed hash of hashtable.cpp.
+
+#define FNV_OFFSET 2166136261U
+#define FNV_PRIME 16777619U
+
+static hashtype fnv1a(const std::string& str, hashtype hash = FNV_OFFSET) {
+  for(std::size_t ii = 0; ii < str.length(); ii++) {
+    hash ^= str[ii];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+static const char alnum[] =
+  "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+// Names whose FNV-1a hash has the same bits under hashmask1. The low
+// bits of FNV-1a only depend on the low bits of its state, and the
+// multiplication is invertible, so the states from which two more
+// characters lead to the target are found backwards. A unique prefix
+// with one more character ends in such a state for most prefixes.
+static void craftNames(std::size_t count, std::vector<std::string>& names) {
+  const hashtype mask = htb::hashmask1;
+  // inverse of the prime modulo 2^32 by Newton iteration
+  hashtype inverse = FNV_PRIME;
+  for(int ii = 0; ii < 5; ii++) {
+    inverse *= 2 - FNV_PRIME * inverse;
+  }
+  hashtype target = fnv1a("adversary") & mask;
+  std::vector<std::string> suffix(mask + 1);
+  for(const char* c2 = alnum; '\0' != *c2; c2++) {
+    hashtype state1 = ((target * inverse) & mask) ^ *c2;
+    for(const char* c1 = alnum; '\0' != *c1; c1++) {
+      hashtype state0 = ((state1 * inverse) & mask) ^ *c1;
+      suffix[state0] = std::string(1, *c1) + *c2;
+    }
+  }
+  for(unsigned long ii = 0; names.size() < count; ii++) {
+    std::string prefix = streamgen::userName(ii);
+    hashtype state = fnv1a(prefix);
+    for(const char* c0 = alnum; '\0' != *c0; c0++) {
+      hashtype next = (state ^ *c0) * FNV_PRIME;
+      if( ! suffix[next & mask].empty() ) {
+        names.push_back(prefix + *c0 + suffix[next & mask]);
+        break;
+      }
+    }
+  }
+  // in order, each name would go to the front of its sorted bucket
+  std::mt19937 rng(1);
+  std::shuffle(names.begin(), names.end(), rng);
+}
+
+// Name as list content, ordered like Node
+class benchname : public Content {
+public:
+  std::string str;
+  benchname(const std::string& str): str(str) {};
+  int compare(Content* content) const {
+    return str.compare(static_cast<benchname*>(content)->str);
+  }
+};
+
+// Put all names into a table, find each, remove each, and report the
+// time per name of each step
+static void runCase(const char* label, const std::vector<std::string>& names,
+                    bool keyed, std::size_t treeify) {
+  Hashtable table(htb::hashmask1 + 1);
+  table.setTreeify(treeify);
+  std::vector<hashtype> hashes(names.size());
+  for(std::size_t ii = 0; ii < names.size(); ii++) {
+    hashes[ii] = keyed ? htb::mkhash1(names[ii])
+                       : (fnv1a(names[ii]) & htb::hashmask1);
+  }
+  unsigned long long start = latency::now();
+  for(std::size_t ii = 0; ii < names.size(); ii++) {
+    table.insertListContent(new benchname(names[ii]), hashes[ii]);
+  }
+  unsigned long long inserted = latency::now();
+  std::size_t found = 0;
+  for(std::size_t ii = 0; ii < names.size(); ii++) {
+    benchname probe(names[ii]);
+    List* beflist = table.findBef(&probe, hashes[ii]);
+    if( NULL != beflist && 0 == probe.compare(beflist->getContent()) ) {
+      found++;
+    }
+  }
+  unsigned long long looked = latency::now();
+  std::size_t trees = table.treeCount();
+  for(std::size_t ii = 0; ii < names.size(); ii++) {
+    benchname probe(names[ii]);
+    List* beflist = table.findBef(&probe, hashes[ii]);
+    table.evictListitem(beflist, hashes[ii]);
+  }
+  unsigned long long removed = latency::now();
+  if( found != names.size() || 0 != table.treeCount() ) {
+    stu::abortf("%s: table lost names\n", label);
+  }
+  double scale = 1.0 / names.size();
+  std::cout << label << " insert_ns " << (inserted - start) * scale
+    << " find_ns " << (looked - inserted) * scale
+    << " remove_ns " << (removed - looked) * scale
+    << " trees " << trees << std::endl;
+}
+
+void usage(const char* prog) {
+  stu::abortf("usage: %s [options]\n"
+    "  -n <names>     colliding names (20000)\n"
+    "  -o <file>      also write records between consecutive names, all\n"
+    "                 in one second, for rolling_median\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t count = 20000;
+  const char* outfname = NULL;
+  int opt;
+  while( -1 != (opt = getopt(argc, argv, "n:o:")) ) {
+    switch( opt ) {
+      case 'n': {
+        char* end;
+        count = strtoul(optarg, &end, 10);
+        if( end == optarg || '\0' != *end || count < 2 ) {
+          usage(argv[0]);
+        }
+        break;
+      }
+      case 'o':
+        outfname = optarg;
+        break;
+      default: usage(argv[0]);
+    }
+  }
+  if( argc != optind ) {
+    usage(argv[0]);
+  }
+  std::vector<std::string> names;
+  craftNames(count, names);
+
+  if( NULL != outfname ) {
+    std::ofstream outfile(outfname);
+    if( ! outfile.is_open() ) {
+      stu::abortf("Cannot write %s\n", outfname);
+    }
+    std::string time = streamgen::timeString(1460000000);
+    for(std::size_t ii = 0; ii + 1 < names.size(); ii++) {
+      outfile << "{\"created_time\": \"" << time << "\", \"target\": \""
+        << names[ii + 1] << "\", \"actor\": \"" << names[ii] << "\"}\n";
+    }
+  }
+
+  runCase("fnv_lists", names, false, 0);
+  runCase("fnv_trees", names, false, TREEIFY);
+  runCase("keyed", names, true, TREEIFY);
+  return 0;
+}
@@ -1,47 +1,80 @@
 #include <iostream>
 #include <string>
+#include <cstring>       // memcpy
+#include <random>
 #include "graph.h"
 #include "stringutils.h"
 
+// Process key of the hashes, drawn before main
+static unsigned long long sipkey[2];
 
-// FNV-1a hash algorithm for short strings from
-// http://www.isthe.com/chongo/tech/comp/fnv/
-hashtype calc_hash(std::string str) {
-
-// I will use 32 bit version, as the array will be smaller than that
-#define FNV_OFFSET32 2166136261
-#define FNV_OFFSET64 14695981039346656037
-#define FNV_PRIME32 16777619
-#define FNV_PRIME64 1099511628211
-
-  hashtype hash = FNV_OFFSET32;
-  for(std::string::iterator it = str.begin(); it != str.end(); ++it) {
-    hash ^= *it;
-    hash *= FNV_PRIME32;
+static bool drawKey() {
+  std::random_device rd;
+  for(int ii = 0; ii < 2; ii++) {
+    sipkey[ii] = ((unsigned long long) rd() << 32) ^ rd();
   }
-  return hash;
+  return true;
 }
 
+static bool keydrawn = drawKey();
+
+#define ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND { \
+    v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32); \
+    v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32); }
+
 namespace hashtable {
-  // bit mask for node hash table, table allocation will be for
-  // hashmask1 + 1
-  const hashtype hashmask1 = 0xFFFF;
-  // use hashmask == 1 to provoke hash collisions for linked list testing
-  // const hashtype hashmask1 = 1;
-  // bit mask for edge hash table for each of 60 seconds = node mask/8
-  const hashtype hashmask2 = (hashmask1 >> 3);
-  // use hashmask == 1 to provoke hash collisions for linked list testing
-  // const hashtype hashmask2 = 1;
+  // SipHash-2-4 from https://131002.net/siphash/, a keyed hash made
+  // for hash tables fed by untrusted input: without the key, colliding
+  // names cannot be found. Words are read in host byte order, which is
+  // the reference little endian one on x86.
+  unsigned long long siphash(const char* data, std::size_t len) {
+    unsigned long long v0 = 0x736f6d6570736575ULL ^ sipkey[0];
+    unsigned long long v1 = 0x646f72616e646f6dULL ^ sipkey[1];
+    unsigned long long v2 = 0x6c7967656e657261ULL ^ sipkey[0];
+    unsigned long long v3 = 0x7465646279746573ULL ^ sipkey[1];
+    const char* end = data + (len & ~(std::size_t) 7);
+    unsigned long long word;
+    for(; data != end; data += 8) {
+      memcpy(&word, data, 8);
+      v3 ^= word;
+      SIPROUND SIPROUND
+      v0 ^= word;
+    }
+    // last 0 to 7 bytes with the length in the top byte
+    word = (unsigned long long) len << 56;
+    for(std::size_t ii = 0; ii < (len & 7); ii++) {
+      word |= (unsigned long long) (unsigned char) data[ii] << (8 * ii);
+    }
+    v3 ^= word;
+    SIPROUND SIPROUND
+    v0 ^= word;
+    v2 ^= 0xff;
+    SIPROUND SIPROUND SIPROUND SIPROUND
+    return v0 ^ v1 ^ v2 ^ v3;
+  }
+
+  void setKey(unsigned long long k0, unsigned long long k1) {
+    sipkey[0] = k0;
+    sipkey[1] = k1;
+  }
+
+  hashtype mkhash(const std::string& str) {
+    return siphash(str.data(), str.length());
+  }
 
-  hashtype mkhash1(std::string str) {
-    return ( calc_hash(str) ) & hashmask1;
+  hashtype mkhash1(const std::string& str) {
+    return siphash(str.data(), str.length()) & hashmask1;
   }
 
-  hashtype mkhash2(std::string str1, std::string str2) {
+  hashtype mkhash2(const std::string& str1, const std::string& str2) {
     // Concatenate actor name and target name.
     // With actor and target previously lexicographically ordered,
     // this is symmetrized for non-directional edges.
-    return ( calc_hash(str1 + str2) ) & hashmask2;
+    std::string both = str1 + str2;
+    return siphash(both.data(), both.length()) & hashmask2;
   }
 }
 
@@ -84,10 +117,15 @@ List* List::findBef(Content* mycon) {
 }
 
 Hashtable::~Hashtable() {
+  delete trees;
   free(table);
 }
 
+// Emptying a bucket drops its tree, its items may be deleted already
 inline void Hashtable::putContent(Content* content, hashtype hash) {
+  if( NULL == content && NULL != trees ) {
+    trees->erase(hash);
+  }
   table[hash] = content;
 }
 
@@ -95,7 +133,95 @@ inline Content* Hashtable::getContent(hashtype hash) const {
   return table[hash];
 }
 
+std::size_t Hashtable::getSize() const {
+  return size;
+}
+
+void Hashtable::setTreeify(std::size_t walked) {
+  treeify = walked;
+}
+
+std::size_t Hashtable::treeCount() const {
+  return (NULL == trees) ? 0 : trees->size();
+}
+
+std::size_t Hashtable::tableBytes() const {
+  return sizeof(Hashtable) + size * sizeof(Content*);
+}
+
+std::size_t Hashtable::treeBytes() const {
+  if( NULL == trees ) {
+    return 0;
+  }
+  std::size_t bytes = sizeof(*trees)
+    + trees->bucket_count() * sizeof(void*);
+  for(std::unordered_map<hashtype, bucketindex>::const_iterator it =
+      trees->begin(); it != trees->end(); ++it) {
+    bytes += sizeof(*it) + sizeof(void*)
+      + it->second.size() * (sizeof(List*) + 4 * sizeof(void*));
+  }
+  return bytes;
+}
+
+void Hashtable::growTree(hashtype hash) {
+  if( NULL == trees ) {
+    trees = new std::unordered_map<hashtype, bucketindex>();
+  }
+  bucketindex& tree = (*trees)[hash];
+  // items come in order, so each goes at the end
+  for(List* mylist = static_cast<List*>(table[hash]); NULL != mylist;
+      mylist = mylist->getNext()) {
+    tree.insert(tree.end(), mylist);
+  }
+}
+
+List* Hashtable::findBef(Content* mycon, hashtype hash) {
+  if( NULL != trees && ! trees->empty() ) {
+    std::unordered_map<hashtype, bucketindex>::iterator it =
+      trees->find(hash);
+    if( trees->end() != it ) {
+      // first item after mycon, the one before is the result
+      List probe(mycon);
+      bucketindex::iterator after = it->second.upper_bound(&probe);
+      return (it->second.begin() == after) ? NULL : *(--after);
+    }
+  }
+  List* mylist = static_cast<List*>(table[hash]);
+  if( NULL == mylist ) {
+    return NULL;
+  }
+  List* beflist = NULL;
+  std::size_t walked = 0;
+  while( NULL != mylist && 0 >= mycon->compare(mylist->getContent()) ) {
+    beflist = mylist;
+    mylist = mylist->getNext();
+    walked++;
+  }
+  if( 0 != treeify && walked >= treeify ) {
+    growTree(hash);
+  }
+  return beflist;
+}
+
 void Hashtable::evictListitem(List* mylist, hashtype ehash) {
+  unlinkListitem(mylist, ehash);
+  // Next line could go into destructor of List class but then we'd rely on
+  // having each element referenced only once, making reuse of code harder.
+  delete mylist->getContent();
+  delete mylist;
+}
+
+void Hashtable::unlinkListitem(List* mylist, hashtype ehash) {
+  if( NULL != trees && ! trees->empty() ) {
+    std::unordered_map<hashtype, bucketindex>::iterator it =
+      trees->find(ehash);
+    if( trees->end() != it ) {
+      it->second.erase(mylist);
+      if( it->second.size() <= UNTREEIFY ) {
+        trees->erase(it);
+      }
+    }
+  }
   List* prevlist = mylist->getPrev();
   List* nextlist = mylist->getNext();
   // First item in list?
@@ -112,10 +238,6 @@ void Hashtable::evictListitem(List* mylist, hashtype ehash) {
       nextlist->putPrev(prevlist);
     }
   }
-  // Next line could go into destructor of List class but then we'd rely on
-  // having each element referenced only once, making reuse of code harder.
-  delete mylist->getContent();
-  delete mylist;
 }
 
 Content* Hashtable::insertListContent(Content* mycon, hashtype hash) {
@@ -128,11 +250,12 @@ Content* Hashtable::insertListContent(Content* mycon, hashtype hash) {
     // Hash collision - we hope this is rare unless same content
     // Search through doubly linked, lexicographically sorted list
     // Find "before" list item of smaller or equal content
-    List* beflist = mylist->findBef(mycon);
+    List* beflist = findBef(mycon, hash);
+    List* newlist = NULL;
     if( NULL == beflist ) {
       // First item is greater than mycon, insert mycon in front of
       // existing items, we know mylist != NULL
-      List* newlist = new List(mycon);
+      newlist = new List(mycon);
       mylist->putPrev(newlist);
       newlist->putNext(mylist);
       // register newlist as first list element with hash table
@@ -146,7 +269,7 @@ Content* Hashtable::insertListContent(Content* mycon, hashtype hash) {
       } else {
         // We are somewhere in the middle or at the end. Get next list element.
         mylist = beflist->getNext();
-        List* newlist = new List(mycon);
+        newlist = new List(mycon);
         // If we are at the end, append.
         if( NULL != mylist ) {
           // Connect forwards
@@ -158,7 +281,32 @@ Content* Hashtable::insertListContent(Content* mycon, hashtype hash) {
         newlist->putPrev(beflist);
       }
     }
+    if( NULL != newlist && NULL != trees && ! trees->empty() ) {
+      std::unordered_map<hashtype, bucketindex>::iterator it =
+        trees->find(hash);
+      if( trees->end() != it ) {
+        it->second.insert(newlist);
+      }
+    }
   }
 
   return mycon;
 }
+
+void Hashtable::prefetchSlot(hashtype hash) const {
+  __builtin_prefetch(&table[hash]);
+}
+
+void Hashtable::prefetchList(hashtype hash) const {
+  if( NULL != table[hash] ) {
+    __builtin_prefetch(table[hash]);
+  }
+}
+
+// static_cast, as items are always List here and the type info lookups
+// of dynamic_cast would only add loads
+void Hashtable::prefetchContent(hashtype hash) const {
+  if( NULL != table[hash] ) {
+    __builtin_prefetch(static_cast<List*>(table[hash])->getContent());
+  }
+}
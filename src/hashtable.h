@@ -2,6 +2,8 @@
 #define GRAPH_H
 #include <cstddef>
 #include <string>
+#include <set>
+#include <unordered_map>
 
 typedef unsigned int hashtype;
 
@@ -14,10 +16,27 @@ public:
 };
 
 namespace hashtable {
-  extern const hashtype hashmask1;
-  extern const hashtype hashmask2;
-  hashtype mkhash1(std::string str);
-  hashtype mkhash2(std::string str1, std::string str2);
+  // bit mask for node hash table, table allocation will be for
+  // hashmask1 + 1. Defined here so it is a compile-time constant,
+  // e.g. for the template parameters of TGraph.
+  const hashtype hashmask1 = 0xFFFF;
+  // use hashmask == 1 to provoke hash collisions for linked list testing
+  // const hashtype hashmask1 = 1;
+  // bit mask for edge hash table for each of 60 seconds = node mask/8
+  const hashtype hashmask2 = (hashmask1 >> 3);
+  // use hashmask == 1 to provoke hash collisions for linked list testing
+  // const hashtype hashmask2 = 1;
+  // Hashes are keyed with a random key drawn once per process, so
+  // names crafted to collide in one run do not collide in another.
+  // unmasked hash, for tables that size themselves
+  hashtype mkhash(const std::string& str);
+  hashtype mkhash1(const std::string& str);
+  hashtype mkhash2(const std::string& str1, const std::string& str2);
+  // SipHash-2-4 of data under the process key
+  unsigned long long siphash(const char* data, std::size_t len);
+  // Replace the process key, only before anything was hashed, e.g. to
+  // check against published test vectors
+  void setKey(unsigned long long k0, unsigned long long k1);
 }
 
 // provide standardized shorthand namespace to save typing
@@ -41,19 +60,42 @@ public:
   virtual List* findBef(Content* mycon);
 };
 
+// Walking more list items than this in one lookup gives the bucket a
+// search tree over its items
+#define TREEIFY 16
+// and a bucket shrinking to this many items loses it again
+#define UNTREEIFY 4
+
+// Orders list items as they are in their bucket, see List::findBef
+struct listorder {
+  bool operator()(const List* a, const List* b) const {
+    return b->getContent()->compare(a->getContent()) < 0;
+  }
+};
+
 // Hash table class derived from Content, so we can have hash tables
 // containing hash tables. Never need to store hash, as it can be
 // computed from location in hash table by pointer arithmetic.
+// Bucket lists that grow long, as when many names collide, also get
+// a balanced tree of their items, so that finding an item stays
+// logarithmic in the bucket size. Lists stay complete, so walking a
+// bucket does not change, but items must then be found, added and
+// removed through the table.
 class Hashtable : public Content {
 protected:
   std::size_t size;
+  typedef std::set<List*, listorder> bucketindex;
+  // trees of long buckets, NULL until a bucket first grows long
+  std::unordered_map<hashtype, bucketindex>* trees;
+  std::size_t treeify;
+  void growTree(hashtype hash);
 
 public:
   Content** table;
 
   // initializer list instead of constructor
   Hashtable(size_t size):
-    size(size) {
+    size(size), trees(NULL), treeify(TREEIFY) {
       // allocate table and initialize with NULL pointers
       table = new Content*[size]();
     };
@@ -61,7 +103,26 @@ public:
   virtual void putContent(Content* content, hashtype hash);
   virtual Content* getContent(hashtype hash) const;
   virtual Content* insertListContent(Content* mycon, hashtype hash);
+  // Last list item in bucket hash before or equal to mycon, NULL if none
+  virtual List* findBef(Content* mycon, hashtype hash);
   virtual void evictListitem(List* mylist, hashtype hash);
+  // Take list item out of its list, leaving it and its content alive,
+  // which must still compare as when it was inserted
+  virtual void unlinkListitem(List* mylist, hashtype hash);
+  virtual std::size_t getSize() const;
+  // Walked items that give a bucket a tree, 0 for plain lists only
+  virtual void setTreeify(std::size_t walked);
+  virtual std::size_t treeCount() const;
+  // Bytes of the table itself and of its bucket trees, the latter as
+  // laid out by red-black tree nodes of one color word and three links
+  virtual std::size_t tableBytes() const;
+  virtual std::size_t treeBytes() const;
+  // Software prefetch in three stages, each touching only memory the
+  // previous stage brought in: bucket slot, first list item, its content.
+  // Only for tables holding List items.
+  virtual void prefetchSlot(hashtype hash) const;
+  virtual void prefetchList(hashtype hash) const;
+  virtual void prefetchContent(hashtype hash) const;
 };
 
 
@@ -0,0 +1,170 @@
+#include <vector>
+#include <algorithm>     // std::push_heap, std::pop_heap, std::sort_heap
+#include <time.h>        // time_t
+#include "epochtime.h"
+#include "venmodata.h"
+#include "venmoio.h"
+#include "hashtable.h"
+#include "graph.h"
+#include "hubindex.h"
+
+
+// Make room for degree deg, doubling like Graph::incMaxdeg
+void HubIndex::grow(uint deg) {
+  if( deg >= heads.size() ) {
+    std::size_t newsize = heads.size() << 1;
+    while( deg >= newsize ) {
+      newsize <<= 1;
+    }
+    heads.resize(newsize, NULL);
+    up.resize(newsize, 0);
+    down.resize(newsize, 0);
+  }
+}
+
+// Push node to front of bucket deg, which must already be linked in
+// the list of non-empty degrees
+void HubIndex::linkNode(Node* node, uint deg) {
+  node->hubprev = NULL;
+  node->hubnext = heads[deg];
+  if( NULL != heads[deg] ) {
+    heads[deg]->hubprev = node;
+  }
+  heads[deg] = node;
+}
+
+void HubIndex::unlinkNode(Node* node, uint deg) {
+  if( NULL == node->hubprev ) {
+    heads[deg] = node->hubnext;
+  } else {
+    node->hubprev->hubnext = node->hubnext;
+  }
+  if( NULL != node->hubnext ) {
+    node->hubnext->hubprev = node->hubprev;
+  }
+  if( NULL == heads[deg] ) {
+    unlinkDegree(deg);
+  }
+}
+
+// Drop empty bucket deg from list of non-empty degrees
+void HubIndex::unlinkDegree(uint deg) {
+  if( 0 == up[deg] ) {
+    top = down[deg];
+  } else {
+    down[up[deg]] = down[deg];
+  }
+  if( 0 == down[deg] ) {
+    bottom = up[deg];
+  } else {
+    up[down[deg]] = up[deg];
+  }
+  up[deg] = down[deg] = 0;
+}
+
+void HubIndex::add(Node* node) {
+  if( NULL == heads[1] ) {
+    // degree 1 becomes the lowest non-empty degree
+    up[1] = bottom;
+    down[1] = 0;
+    if( 0 == bottom ) {
+      top = 1;
+    } else {
+      down[bottom] = 1;
+    }
+    bottom = 1;
+  }
+  linkNode(node, 1);
+}
+
+void HubIndex::moveUp(Node* node, uint deg) {
+  grow(deg + 1);
+  if( NULL == heads[deg + 1] ) {
+    // deg is non-empty as it still holds node, insert deg + 1 above it
+    up[deg + 1] = up[deg];
+    down[deg + 1] = deg;
+    if( 0 == up[deg] ) {
+      top = deg + 1;
+    } else {
+      down[up[deg]] = deg + 1;
+    }
+    up[deg] = deg + 1;
+  }
+  unlinkNode(node, deg);
+  linkNode(node, deg + 1);
+}
+
+void HubIndex::moveDown(Node* node, uint deg) {
+  move(node, deg, deg - 1);
+}
+
+void HubIndex::move(Node* node, uint from, uint to) {
+  if( 0 == to ) {
+    unlinkNode(node, from);
+    return;
+  }
+  if( NULL == heads[to] ) {
+    // from still holds node, insert to between the nearest non-empty
+    // degrees below and above it
+    uint below = down[from];
+    while( below > to ) {
+      below = down[below];
+    }
+    uint above = (0 == below) ? bottom : up[below];
+    down[to] = below;
+    up[to] = above;
+    if( 0 == below ) {
+      bottom = to;
+    } else {
+      up[below] = to;
+    }
+    down[above] = to;
+  }
+  unlinkNode(node, from);
+  linkNode(node, to);
+}
+
+std::size_t HubIndex::bytes() const {
+  return heads.capacity() * sizeof(Node*)
+    + (up.capacity() + down.capacity()) * sizeof(uint);
+}
+
+// Only the bucket heads need resetting, the nodes themselves are gone
+void HubIndex::clear() {
+  uint deg = top;
+  while( 0 != deg ) {
+    uint next = down[deg];
+    heads[deg] = NULL;
+    up[deg] = down[deg] = 0;
+    deg = next;
+  }
+  top = bottom = 0;
+}
+
+// Nodes of the same degree by name, bucket order depends on the order
+// of evictions, which follows the keyed hashes of hashtable.cpp
+bool HubIndex::byName(const Node* a, const Node* b) {
+  return a->str < b->str;
+}
+
+// Ties are broken by name so that reports do not change between runs.
+// Each bucket is walked with a max-heap by name of at most k nodes, so
+// only k nodes are ever held and sorted, but all nodes of the lowest
+// degree listed are looked at.
+void HubIndex::topNodes(uint k, std::vector<Node*>& hubs) const {
+  for(uint deg = top; 0 != deg && k > 0; deg = down[deg]) {
+    std::size_t first = hubs.size();
+    for(Node* node = heads[deg]; NULL != node; node = node->hubnext) {
+      if( hubs.size() - first < k ) {
+        hubs.push_back(node);
+        std::push_heap(hubs.begin() + first, hubs.end(), byName);
+      } else if( byName(node, hubs[first]) ) {
+        std::pop_heap(hubs.begin() + first, hubs.end(), byName);
+        hubs.back() = node;
+        std::push_heap(hubs.begin() + first, hubs.end(), byName);
+      }
+    }
+    std::sort_heap(hubs.begin() + first, hubs.end(), byName);
+    k -= hubs.size() - first;
+  }
+}
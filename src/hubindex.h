@@ -0,0 +1,54 @@
+#ifndef HUBINDEX_H
+#define HUBINDEX_H
+#include <vector>
+
+class Node;
+
+// For convenience
+typedef unsigned int uint;
+
+// Index of nodes by degree for live top-k queries. Like Graph::degrees
+// it is keyed by degree, but instead of counting nodes it keeps every
+// node in a doubly linked bucket list for its degree, and links the
+// non-empty buckets to each other in degree order. Degrees only ever
+// change by one, so each move between buckets is O(1), and the k
+// highest degree nodes are found by walking down from the top, through
+// the buckets of the degrees listed. Ties are broken by name with a heap
+// of at most k nodes, so a query costs O(k log k) plus the length of
+// the lowest degree bucket it reaches, e.g. all degree 1 nodes. A node
+// losing several edges at once moves in one step, walking down only the
+// non-empty degrees it passes.
+class HubIndex {
+protected:
+  // first node of bucket for each degree
+  std::vector<Node*> heads;
+  // next higher and next lower non-empty degree, 0 for none
+  std::vector<uint> up, down;
+  uint top, bottom;
+  void grow(uint deg);
+  void linkNode(Node* node, uint deg);
+  void unlinkNode(Node* node, uint deg);
+  void unlinkDegree(uint deg);
+  static bool byName(const Node* a, const Node* b);
+
+public:
+  HubIndex(): heads(2048, (Node*)0), up(2048, 0), down(2048, 0),
+    top(0), bottom(0) {};
+  // New node of degree 1
+  void add(Node* node);
+  // Node degree went from deg to deg + 1
+  void moveUp(Node* node, uint deg);
+  // Node degree went from deg to deg - 1, removes node if now 0
+  void moveDown(Node* node, uint deg);
+  // Node degree went down from from to to, removes node if to is 0
+  void move(Node* node, uint from, uint to);
+  // Forget all nodes, e.g. when Graph::evictAll deletes them
+  void clear();
+  // Bytes of the per degree vectors, nodes hold their own links
+  std::size_t bytes() const;
+  // Append up to k highest degree nodes to hubs, highest first, then
+  // by name, looking at every node of the lowest degree listed
+  void topNodes(uint k, std::vector<Node*>& hubs) const;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include <string>
+#include <sstream>       // std::ostringstream
+#include <iomanip>       // std::setprecision
+#include <cmath>         // ceil
+#include <chrono>
+#include "latency.h"
+
+
+unsigned long long latency::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+LatencyHistogram::LatencyHistogram() {
+  // exact buckets for 0 <= value < 2^LATBITS, then one group of
+  // 2^(LATBITS-1) buckets per remaining power of two up to 2^63
+  nbuckets = (1 << LATBITS) + (64 - LATBITS) * (1 << (LATBITS - 1));
+  counts = new unsigned long long[nbuckets]();
+  total = 0;
+  maxval = 0;
+}
+
+LatencyHistogram::~LatencyHistogram() {
+  delete [] counts;
+}
+
+unsigned int LatencyHistogram::bucketOf(unsigned long long value) const {
+  if( value < (1ULL << LATBITS) ) {
+    return value;
+  }
+  // position of leading bit, >= LATBITS
+  unsigned int msb = 63 - __builtin_clzll(value);
+  // next LATBITS-1 bits below the leading bit select the sub-bucket
+  unsigned int sub = (value >> (msb - (LATBITS - 1))) - (1 << (LATBITS - 1));
+  return (1 << LATBITS) + (msb - LATBITS) * (1 << (LATBITS - 1)) + sub;
+}
+
+// Largest value that lands in bucket, reported for percentiles,
+// so results never understate a latency
+unsigned long long LatencyHistogram::highestIn(unsigned int bucket) const {
+  if( bucket < (1U << LATBITS) ) {
+    return bucket;
+  }
+  unsigned int offset = bucket - (1 << LATBITS);
+  unsigned int msb = LATBITS + offset / (1 << (LATBITS - 1));
+  unsigned long long sub = offset % (1 << (LATBITS - 1));
+  unsigned int shift = msb - (LATBITS - 1);
+  return ((sub + (1 << (LATBITS - 1)) + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(unsigned long long value) {
+  counts[bucketOf(value)]++;
+  total++;
+  if( value > maxval ) {
+    maxval = value;
+  }
+}
+
+// Coordinated omission correction as in HdrHistogram's
+// recordValueWithExpectedInterval: a value of n intervals stands for
+// the n-1 requests that would have queued up behind it.
+void LatencyHistogram::recordCorrected(unsigned long long value,
+                                       unsigned long long interval) {
+  record(value);
+  if( 0 == interval ) {
+    return;
+  }
+  for(unsigned long long missing = (value > interval) ? value - interval : 0;
+      missing >= interval; missing -= interval) {
+    record(missing);
+  }
+}
+
+void LatencyHistogram::reset() {
+  for(unsigned int ii = 0; ii < nbuckets; ii++) {
+    counts[ii] = 0;
+  }
+  total = 0;
+  maxval = 0;
+}
+
+unsigned long long LatencyHistogram::getCount() const {
+  return total;
+}
+
+unsigned long long LatencyHistogram::getMax() const {
+  return maxval;
+}
+
+unsigned long long LatencyHistogram::percentile(double percent) const {
+  if( 0 == total ) {
+    return 0;
+  }
+  unsigned long long target =
+    (unsigned long long)ceil(percent / 100.0 * total);
+  if( target < 1 ) {
+    target = 1;
+  }
+  unsigned long long sum = 0;
+  for(unsigned int ii = 0; ii < nbuckets; ii++) {
+    sum += counts[ii];
+    if( sum >= target ) {
+      unsigned long long high = highestIn(ii);
+      return (high < maxval) ? high : maxval;
+    }
+  }
+  return maxval;
+}
+
+std::string LatencyHistogram::summary(double unit) const {
+  std::ostringstream outstr;
+  outstr << std::fixed << std::setprecision(3)
+    << "p50 " << percentile(50.0) / unit
+    << " p99 " << percentile(99.0) / unit
+    << " p99.9 " << percentile(99.9) / unit
+    << " max " << maxval / unit;
+  return outstr.str();
+}
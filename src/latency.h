@@ -0,0 +1,42 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+#include <string>
+
+// Number of bits for exactly counted small values, values above get
+// 2^(LATBITS-1) buckets per power of two, i.e. better than 2% resolution
+#define LATBITS 7
+
+// Histogram of latencies in the style of HdrHistogram: log-linear buckets
+// with fixed relative precision over the full 64 bit range, constant
+// memory and O(1) recording, so it can sit in a hot loop.
+class LatencyHistogram {
+protected:
+  unsigned long long* counts;
+  unsigned long long total, maxval;
+  unsigned int nbuckets;
+  unsigned int bucketOf(unsigned long long value) const;
+  unsigned long long highestIn(unsigned int bucket) const;
+
+public:
+  LatencyHistogram();
+  ~LatencyHistogram();
+  void record(unsigned long long value);
+  // Also record the values a stalled measurement loop failed to sample,
+  // given the interval at which values were expected to arrive
+  void recordCorrected(unsigned long long value,
+                       unsigned long long interval);
+  void reset();
+  unsigned long long getCount() const;
+  unsigned long long getMax() const;
+  // Value at or below which percent of recorded values fall
+  unsigned long long percentile(double percent) const;
+  // One line summary "p50 .. p99 .. p99.9 .. max .." in given unit
+  std::string summary(double unit = 1.0) const;
+};
+
+namespace latency {
+  // Monotonic clock in nanoseconds
+  unsigned long long now();
+}
+
+#endif
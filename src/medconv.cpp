@@ -0,0 +1,84 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include "emitter.h"
+#include "binout.h"
+#include "stringutils.h"
+
+
+// Converter of binary median output, see binout.h, back to text
+
+void usage(const char* prog) {
+  stu::abortf("usage: %s [-c] <binary input> <text output>\n"
+    "  writes the text rolling_median would have written with the same\n"
+    "  --emit mode\n"
+    "  -c  write all stored columns instead, after a header line\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+  bool allcols = false;
+  int opt;
+  while( -1 != (opt = getopt(argc, argv, "c")) ) {
+    switch( opt ) {
+      case 'c': allcols = true; break;
+      default: usage(argv[0]);
+    }
+  }
+  if( argc - optind != 2 ) {
+    usage(argv[0]);
+  }
+  std::ifstream infile(argv[optind], std::ios::in | std::ios::binary);
+  if( ! infile.is_open() ) {
+    stu::abortf("Cannot read %s\n", argv[optind]);
+  }
+  std::ofstream outfile(argv[optind + 1]);
+  if( ! outfile.is_open() ) {
+    stu::abortf("Cannot write %s\n", argv[optind + 1]);
+  }
+
+  binreader reader(infile);
+  if( ! reader.readHeader() ) {
+    // empty input, empty output
+    return 0;
+  }
+  unsigned int columns = reader.getColumns();
+  if( allcols ) {
+    outfile << "#";
+    for(int col = 0; col < BIN_NCOLS; col++) {
+      if( columns & (1U << col) ) {
+        outfile << " " << binreader::columnName(col);
+      }
+    }
+    outfile << '\n';
+  }
+  std::vector<long long> values[BIN_NCOLS];
+  unsigned int rows;
+  while( reader.readBlock(values, rows) ) {
+    for(unsigned int ii = 0; ii < rows; ii++) {
+      if( allcols ) {
+        bool first = true;
+        for(int col = 0; col < BIN_NCOLS; col++) {
+          if( columns & (1U << col) ) {
+            outfile << (first ? "" : " ");
+            if( 1 == col ) {
+              outfile << emitter::format(values[col][ii]);
+            } else {
+              outfile << values[col][ii];
+            }
+            first = false;
+          }
+        }
+      } else {
+        // record index or run length in front as emitter writes it
+        if( columns & BIN_RECORD ) {
+          outfile << values[0][ii] << " ";
+        }
+        outfile << emitter::format(values[1][ii]);
+      }
+      outfile << '\n';
+    }
+  }
+  return 0;
+}
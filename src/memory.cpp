@@ -0,0 +1,56 @@
+#include <string>
+#include <cstdlib>       // strtoull
+#include "memory.h"
+
+
+bool MemoryBudget::due(std::size_t bytes) {
+  if( bytes > peak ) {
+    peak = bytes;
+  }
+  if( ! armed ) {
+    armed = bytes < MEMLOW * budget;
+    return false;
+  }
+  if( near(bytes) ) {
+    armed = false;
+    return true;
+  }
+  return false;
+}
+
+bool MemoryBudget::near(std::size_t bytes) const {
+  return bytes >= MEMHIGH * budget;
+}
+
+bool MemoryBudget::parseSpec(const char* spec, std::size_t& mybudget,
+                             int& myaction) {
+  char* end;
+  unsigned long long bytes = strtoull(spec, &end, 10);
+  if( end == spec ) {
+    return false;
+  }
+  switch( *end ) {
+    case 'G': bytes <<= 10;   // fall through
+    case 'M': bytes <<= 10;   // fall through
+    case 'K': bytes <<= 10;
+      end++;
+      break;
+  }
+  myaction = MEM_WARN;
+  if( ':' == *end ) {
+    std::string action = end + 1;
+    if( "warn" == action ) {
+      myaction = MEM_WARN;
+    } else if( "compact" == action ) {
+      myaction = MEM_COMPACT;
+    } else if( "approx" == action ) {
+      myaction = MEM_APPROX;
+    } else {
+      return false;
+    }
+  } else if( '\0' != *end ) {
+    return false;
+  }
+  mybudget = bytes;
+  return 0 != mybudget;
+}
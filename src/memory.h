@@ -0,0 +1,69 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+#include <cstddef>
+#include <string>
+
+// Actions when the bytes in use near the budget, see MemoryBudget
+#define MEM_WARN    0   // warn on stderr
+#define MEM_COMPACT 1   // shrink tables and return free heap to the
+                        // system, then warn if still near the budget
+#define MEM_APPROX  2   // hand the window to the approximate engine
+
+// Share of the budget that triggers the action, and the share use must
+// fall below before the action may trigger again
+#define MEMHIGH 0.9
+#define MEMLOW 0.8
+
+// Records between two counts of the bytes in use
+#define MEMCHECK 1024
+
+// Bytes per node, edge or ring entry of ApproxGraph, to turn a budget in
+// bytes into its budget in entries
+#define APPROXENTRY 64
+
+// Bytes held by the window of an engine by kind, an estimate from the
+// sizes of the objects and the heap parts of names, without the
+// overhead of the allocator. Components are the forests of DynConn,
+// pending the evicted objects waiting for the Reclaimer, counted as
+// edges with their list item, buffers the prefetch batch and the
+// nodes touched by one eviction.
+struct memusage {
+  std::size_t nodes, edges, lists, tables, histograms, trees, amounts,
+    components, pending, buffers;
+  memusage(): nodes(0), edges(0), lists(0), tables(0), histograms(0),
+    trees(0), amounts(0), components(0), pending(0), buffers(0) {};
+  std::size_t total() const {
+    return nodes + edges + lists + tables + histograms + trees + amounts
+      + components + pending + buffers;
+  }
+};
+
+// Budget for the bytes in use and what to do when they near it. The
+// action is due when use first reaches MEMHIGH of the budget, and again
+// only after use has dropped below MEMLOW, so a window hovering around
+// the threshold does not trigger it on every check.
+class MemoryBudget {
+protected:
+  std::size_t budget;
+  int action;
+  bool armed;
+  std::size_t peak;
+
+public:
+  MemoryBudget(std::size_t budget, int action):
+    budget(budget), action(action), armed(true), peak(0) {};
+  // Note bytes in use, true if the action is due
+  bool due(std::size_t bytes);
+  // Whether bytes are still at or above MEMHIGH of the budget
+  bool near(std::size_t bytes) const;
+  std::size_t getBudget() const { return budget; }
+  int getAction() const { return action; }
+  std::size_t getPeak() const { return peak; }
+
+  // Parse "<bytes>[:warn|compact|approx]", bytes with an optional K, M
+  // or G suffix for powers of 1024
+  static bool parseSpec(const char* spec, std::size_t& mybudget,
+                        int& myaction);
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include <string>
+#include <vector>
+#include "venmodata.h"
+#include "venmofeed.h"
+#include "merge.h"
+
+// Marks that no record was handed out yet
+#define NOFEED 0xFFFFFFFFU
+
+
+venmomerge::venmomerge(const std::vector< std::vector<std::string> >& inputs,
+                       std::size_t blocksize, std::size_t nblocks):
+  blocks(inputs.size()), cursors(inputs.size(), 0), last(NOFEED) {
+  for(std::size_t ii = 0; ii < inputs.size(); ii++) {
+    feeds.push_back(new venmofeed(inputs[ii], blocksize, nblocks));
+  }
+}
+
+// Feeds stop their parsers, also those not read to the end
+venmomerge::~venmomerge() {
+  for(std::size_t ii = 0; ii < feeds.size(); ii++) {
+    delete feeds[ii];
+  }
+}
+
+void venmomerge::setSymmetric(bool mysymmetric) {
+  for(std::size_t ii = 0; ii < feeds.size(); ii++) {
+    feeds[ii]->setSymmetric(mysymmetric);
+  }
+}
+
+void venmomerge::setWide(bool mywide) {
+  for(std::size_t ii = 0; ii < feeds.size(); ii++) {
+    feeds[ii]->setWide(mywide);
+  }
+}
+
+void venmomerge::setAmounts(bool myamounts) {
+  for(std::size_t ii = 0; ii < feeds.size(); ii++) {
+    feeds[ii]->setAmounts(myamounts);
+  }
+}
+
+void venmomerge::start() {
+  for(std::size_t ii = 0; ii < feeds.size(); ii++) {
+    feeds[ii]->start();
+  }
+  for(uint feed = 0; feed < feeds.size(); feed++) {
+    if( fill(feed) ) {
+      push(feed);
+    }
+  }
+}
+
+// Next block of feed with records, skipping empty ones, e.g. of empty
+// files, false once the feed is exhausted
+bool venmomerge::fill(uint feed) {
+  venmoblock block;
+  while( feeds[feed]->next(block) ) {
+    if( ! block.records.empty() ) {
+      blocks[feed] = std::move(block);
+      cursors[feed] = 0;
+      return true;
+    }
+  }
+  blocks[feed] = venmoblock();
+  return false;
+}
+
+void venmomerge::push(uint feed) {
+  heap.push(std::make_pair(blocks[feed].records[cursors[feed]].epochtime,
+    feed));
+}
+
+bool venmomerge::next(venmodata*& vdt) {
+  if( NOFEED != last ) {
+    // the record handed out last may be replaced now
+    if( ++cursors[last] < blocks[last].records.size() || fill(last) ) {
+      push(last);
+    }
+  }
+  if( heap.empty() ) {
+    last = NOFEED;
+    return false;
+  }
+  last = heap.top().second;
+  heap.pop();
+  vdt = &blocks[last].records[cursors[last]];
+  return true;
+}
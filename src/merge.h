@@ -0,0 +1,55 @@
+#ifndef MERGE_H
+#define MERGE_H
+#include <string>
+#include <vector>
+#include <queue>
+#include <utility>       // std::pair
+#include <functional>    // std::greater
+#include <time.h>        // time_t
+#include "venmodata.h"
+#include "venmofeed.h"
+
+// Records per parsed block of a merged feed
+#define MERGEBLOCK 1024
+
+// Parsed blocks a merged feed may run ahead of the merge
+#define MERGEBLOCKS 4
+
+// Merges several feeds, each sorted by created_time, into one stream in
+// time order. Every feed is a venmofeed with its own parser thread, so
+// feeds are parsed concurrently. A min-heap holds the next record of
+// each feed by (epochtime, feed index), so records of the same second
+// come in feed order. A feed's queue holds at most MERGEBLOCKS blocks:
+// while the merge waits for a stalled feed, the others fill their
+// queues and their parsers wait, so memory stays bounded by about
+// (MERGEBLOCKS + 2) * MERGEBLOCK records per feed.
+class venmomerge {
+protected:
+  std::vector<venmofeed*> feeds;
+  std::vector<venmoblock> blocks;
+  std::vector<std::size_t> cursors;
+  std::priority_queue< std::pair<time_t, uint>,
+    std::vector< std::pair<time_t, uint> >,
+    std::greater< std::pair<time_t, uint> > > heap;
+  // feed of the record handed out last, moved on at the next call
+  uint last;
+  bool fill(uint feed);
+  void push(uint feed);
+
+public:
+  // One feed per list of files, read one after the other as venmofeed
+  venmomerge(const std::vector< std::vector<std::string> >& inputs,
+             std::size_t blocksize = MERGEBLOCK,
+             std::size_t nblocks = MERGEBLOCKS);
+  ~venmomerge();
+  void setSymmetric(bool mysymmetric);
+  void setWide(bool mywide);
+  void setAmounts(bool myamounts);
+  // Start all parsers and wait for the first record of each feed
+  void start();
+  // Next record in time order, valid until the next call, false once
+  // all feeds are exhausted
+  bool next(venmodata*& vdt);
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>      // strtoul
+#include <getopt.h>
+#include "timeindex.h"
+#include "stringutils.h"
+
+
+// Builder of the sidecar time index of input files, see timeindex.h
+
+void usage(const char* prog) {
+  stu::abortf("usage: %s [-n <lines>] <inputfile>...\n"
+    "  writes <inputfile>%s for rolling_median --start-at\n"
+    "  -n <lines>  lines between two samples (%d)\n",
+    prog, TIMEINDEXSUFFIX, TIMEINDEXEVERY);
+}
+
+int main(int argc, char* argv[]) {
+  unsigned long every = TIMEINDEXEVERY;
+  int opt;
+  while( -1 != (opt = getopt(argc, argv, "n:")) ) {
+    switch( opt ) {
+      case 'n': {
+        char* end;
+        every = strtoul(optarg, &end, 10);
+        if( end == optarg || '\0' != *end || 0 == every ) {
+          usage(argv[0]);
+        }
+        break;
+      }
+      default: usage(argv[0]);
+    }
+  }
+  if( argc - optind < 1 ) {
+    usage(argv[0]);
+  }
+  for(int ii = optind; ii < argc; ii++) {
+    std::string infname = argv[ii];
+    TimeIndex index;
+    if( ! index.build(infname, every) ) {
+      stu::abortf("Cannot read input file %s\n", argv[ii]);
+    }
+    if( ! index.save(infname + TIMEINDEXSUFFIX) ) {
+      stu::abortf("Cannot write %s%s\n", argv[ii], TIMEINDEXSUFFIX);
+    }
+    std::cout << infname << TIMEINDEXSUFFIX << ": " << index.sampleCount()
+      << " samples" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,416 @@
+#include <string>
+#include <vector>
+#include <cassert>       // assert
+#include <climits>       // UINT_MAX
+#include "stringutils.h"
+#include "epochtime.h"
+#include "venmodata.h"
+#include "venmoio.h"
+#include "hashtable.h"
+#include "emitter.h"
+#include "multigraph.h"
+
+
+NameStore::NameStore(uint nbuckets): mask(nbuckets - 1), count(0) {
+  buckets.assign(nbuckets, NONODE);
+}
+
+// Double bucket array once nodes outnumber buckets, keeps chains short
+void NameStore::rehash() {
+  std::vector<uint> newbuckets((mask + 1) << 1, NONODE);
+  uint newmask = (mask << 1) | 1;
+  for(uint bucket = 0; bucket <= mask; bucket++) {
+    uint id = buckets[bucket];
+    while( NONODE != id ) {
+      uint next = chain[id];
+      chain[id] = newbuckets[hashes[id] & newmask];
+      newbuckets[hashes[id] & newmask] = id;
+      id = next;
+    }
+  }
+  buckets.swap(newbuckets);
+  mask = newmask;
+}
+
+uint NameStore::findOrAdd(const std::string& name) {
+  hashtype hash = htb::mkhash(name);
+  for(uint id = buckets[hash & mask]; NONODE != id; id = chain[id]) {
+    if( hashes[id] == hash && names[id] == name ) {
+      return id;
+    }
+  }
+  uint id;
+  if( freeids.empty() ) {
+    id = names.size();
+    names.push_back(name);
+    chain.push_back(NONODE);
+    hashes.push_back(hash);
+    live.push_back(0);
+  } else {
+    id = freeids.back();
+    freeids.pop_back();
+    names[id] = name;
+    hashes[id] = hash;
+    live[id] = 0;
+  }
+  chain[id] = buckets[hash & mask];
+  buckets[hash & mask] = id;
+  count++;
+  if( count > mask + 1 ) {
+    rehash();
+  }
+  return id;
+}
+
+void NameStore::release(uint id) {
+  assert( 0 == live[id] );
+  uint* link = &buckets[hashes[id] & mask];
+  while( *link != id ) {
+    assert( NONODE != *link );
+    link = &chain[*link];
+  }
+  *link = chain[id];
+  chain[id] = NONODE;
+  // give back string memory, not just its length
+  std::string().swap(names[id]);
+  freeids.push_back(id);
+  count--;
+}
+
+const std::string& NameStore::getName(uint id) const {
+  return names[id];
+}
+
+uint NameStore::idRange() const {
+  return names.size();
+}
+
+uint NameStore::size() const {
+  return count;
+}
+
+uint& NameStore::liveCount(uint id) {
+  return live[id];
+}
+
+
+WindowLayer::WindowLayer(NameStore* store, uint window):
+  store(store), window(window), currtime(-(time_t)window), peakedges(0),
+  maxedges(0), ring(window), maxdeg(1), degsize(2048), spill(NULL),
+  hot(window) {
+  degrees = new uint[degsize]();
+}
+
+WindowLayer::~WindowLayer() {
+  delete [] degrees;
+}
+
+uint WindowLayer::getWindow() const {
+  return window;
+}
+
+std::size_t WindowLayer::edgesPeak() const {
+  return peakedges;
+}
+
+void WindowLayer::setSpill(SpillStore* mystore, uint myhot,
+                           std::size_t myedges) {
+  if( myhot < window ) {
+    spill = mystore;
+    hot = myhot;
+    maxedges = myedges;
+    spilled.assign(window, std::vector<spillextent>());
+  }
+}
+
+void WindowLayer::incDeg(uint id) {
+  if( id >= deg.size() ) {
+    deg.resize(store->idRange(), 0);
+  }
+  uint mydeg = deg[id]++;
+  if( 0 == mydeg ) {
+    store->liveCount(id)++;
+  } else {
+    degrees[mydeg]--;
+  }
+  degrees[mydeg + 1]++;
+  if( mydeg + 1 > maxdeg ) {
+    maxdeg = mydeg + 1;
+    // grow occupation array by doubling as Graph::incMaxdeg
+    if( maxdeg + 1 >= degsize ) {
+      if( maxdeg >= (UINT_MAX >> 1) ) {
+        stu::abortf("Detected extremely high node degree, aborting.\n");
+      }
+      uint* temp = new uint[degsize << 1]();
+      for(uint ii = 0; ii <= maxdeg; ii++) {
+        temp[ii] = degrees[ii];
+      }
+      delete [] degrees;
+      degrees = temp;
+      degsize <<= 1;
+    }
+  }
+}
+
+void WindowLayer::decDeg(uint id) {
+  uint mydeg = deg[id]--;
+  degrees[mydeg]--;
+  if( mydeg == maxdeg && 0 == degrees[mydeg] ) {
+    maxdeg--;
+  }
+  if( 1 == mydeg ) {
+    // node left this layer, and the store if no layer holds it
+    if( 0 == --store->liveCount(id) ) {
+      store->release(id);
+    }
+  } else {
+    degrees[mydeg - 1]++;
+  }
+}
+
+void WindowLayer::evictKey(unsigned long long key, time_t time) {
+  std::unordered_map<unsigned long long, time_t>::iterator it =
+    edges.find(key);
+  // skip stale entries of edges refreshed since
+  if( edges.end() != it && it->second == time ) {
+    edges.erase(it);
+    decDeg(key >> 32);
+    decDeg(key & 0xFFFFFFFFULL);
+  }
+}
+
+// Evict the edges whose latest transaction is recorded in this slot,
+// spilled ones first as they were recorded first
+void WindowLayer::evictSlot(uint slot) {
+  if( NULL != spill ) {
+    for(std::size_t ii = 0; ii < spilled[slot].size(); ii++) {
+      spill->stream(spilled[slot][ii], *this);
+    }
+    std::vector<spillextent>().swap(spilled[slot]);
+  }
+  std::vector<EdgeStamp>& stamps = ring[slot];
+  for(std::size_t ii = 0; ii < stamps.size(); ii++) {
+    evictKey(stamps[ii].key, stamps[ii].time);
+  }
+  // release memory of slots that held a burst
+  std::vector<EdgeStamp>().swap(stamps);
+}
+
+// Write keys of slot to spill, all entries of a slot have the same time
+// as a slot is emptied before the second it stands for comes around
+void WindowLayer::spillSlot(uint slot) {
+  std::vector<EdgeStamp>& stamps = ring[slot];
+  if( stamps.empty() ) {
+    return;
+  }
+  spillbuf.resize(stamps.size());
+  for(std::size_t ii = 0; ii < stamps.size(); ii++) {
+    assert( stamps[ii].time == stamps[0].time );
+    spillbuf[ii] = stamps[ii].key;
+  }
+  spilled[slot].push_back(spill->write(&spillbuf[0], spillbuf.size(),
+    stamps[0].time));
+  std::vector<EdgeStamp>().swap(stamps);
+}
+
+void WindowLayer::evictAll() {
+  for(uint id = 0; id < deg.size(); id++) {
+    if( deg[id] > 0 ) {
+      deg[id] = 0;
+      if( 0 == --store->liveCount(id) ) {
+        store->release(id);
+      }
+    }
+  }
+  edges.clear();
+  for(uint slot = 0; slot < window; slot++) {
+    std::vector<EdgeStamp>().swap(ring[slot]);
+    for(std::size_t ii = 0; NULL != spill && ii < spilled[slot].size();
+        ii++) {
+      spill->release(spilled[slot][ii]);
+    }
+    if( NULL != spill ) {
+      std::vector<spillextent>().swap(spilled[slot]);
+    }
+  }
+  for(uint ii = 0; ii <= maxdeg; ii++) {
+    degrees[ii] = 0;
+  }
+  maxdeg = 1;
+}
+
+// Same decisions as Graph::process: ignore records a window or more
+// older than the newest, evict seconds the new record pushes out of
+// the window
+bool WindowLayer::advance(time_t epochtime) {
+  time_t timediff = epochtime - currtime;
+  if( timediff <= -(time_t)window ) {
+    return false;
+  }
+  if( timediff > 0 ) {
+    if( timediff >= (time_t)window ) {
+      evictAll();
+    } else {
+      for(time_t mytime = currtime + 1; mytime <= epochtime; mytime++) {
+        evictSlot(mytime % window);
+      }
+      // seconds turning cold and still in the window, late records
+      // for them stay in memory
+      time_t from = currtime + 1;
+      if( from < epochtime - (time_t)window + (time_t)hot + 1 ) {
+        from = epochtime - (time_t)window + (time_t)hot + 1;
+      }
+      for(time_t mytime = from; NULL != spill && mytime <= epochtime;
+          mytime++) {
+        spillSlot((mytime - hot) % window);
+      }
+    }
+    currtime = epochtime;
+  }
+  return true;
+}
+
+// Let a repeated edge take the time of its latest record
+void WindowLayer::process(uint actor, uint target, time_t epochtime) {
+  if( ! advance(epochtime) ) {
+    return;
+  }
+  unsigned long long key = ((unsigned long long)actor << 32) | target;
+  EdgeStamp stamp = {key, epochtime};
+  std::pair<std::unordered_map<unsigned long long, time_t>::iterator, bool>
+    res = edges.insert(std::make_pair(key, epochtime));
+  if( res.second ) {
+    if( edges.size() > peakedges ) {
+      peakedges = edges.size();
+      if( 0 != maxedges && peakedges > maxedges ) {
+        stu::abortf("Window of %u seconds holds more than %zu live edges, "
+          "the limit of --spill, aborting.\n", window, maxedges);
+      }
+    }
+    incDeg(actor);
+    incDeg(target);
+  } else if( res.first->second != epochtime ) {
+    // degrees stay, edge moves to the slot of its new time
+    res.first->second = epochtime;
+  } else {
+    // same edge at same second is already in the right slot
+    return;
+  }
+  ring[epochtime % window].push_back(stamp);
+}
+
+uint WindowLayer::median2() const {
+  assert( 0 == degrees[0] );
+  uint ii;
+  unsigned long long int sum = 0;
+  for(ii = 0; ii <= maxdeg; ii++) {
+    sum += degrees[ii];
+  }
+  unsigned long long int sum2 = 0;
+  for(ii = 0; ii <= maxdeg; ii++) {
+    sum2 += 2*degrees[ii];
+    if( sum2 >= sum ) {
+      break;
+    }
+  }
+  return 2*ii + ((sum2 > sum) ? 0 : 1);
+}
+
+
+MultiGraph::MultiGraph(venmoio* vio):
+  vio(vio), currtime(0), emit(vio), spill(NULL) {
+  layers.push_back(new WindowLayer(&store, MAXSEC));
+}
+
+MultiGraph::~MultiGraph() {
+  clearLayers();
+  delete spill;
+}
+
+void MultiGraph::clearLayers() {
+  for(std::size_t ii = 0; ii < layers.size(); ii++) {
+    layers[ii]->evictAll();
+    delete layers[ii];
+  }
+  layers.clear();
+}
+
+void MultiGraph::setWindows(const std::vector<uint>& windows) {
+  clearLayers();
+  for(std::size_t ii = 0; ii < windows.size(); ii++) {
+    layers.push_back(new WindowLayer(&store, windows[ii]));
+  }
+}
+
+void MultiGraph::setSpill(const std::string& dir, uint hot,
+                          std::size_t edges) {
+  if( NULL == spill ) {
+    spill = new SpillStore(dir);
+  }
+  for(std::size_t ii = 0; ii < layers.size(); ii++) {
+    layers[ii]->setSpill(spill, hot, edges);
+  }
+}
+
+std::size_t MultiGraph::edgesPeak() const {
+  std::size_t peak = 0;
+  for(std::size_t ii = 0; ii < layers.size(); ii++) {
+    if( layers[ii]->edgesPeak() > peak ) {
+      peak = layers[ii]->edgesPeak();
+    }
+  }
+  return peak;
+}
+
+unsigned long long MultiGraph::spillWritten() const {
+  return (NULL == spill) ? 0 : spill->bytesWritten();
+}
+
+unsigned long long MultiGraph::spillPeak() const {
+  return (NULL == spill) ? 0 : spill->bytesPeak();
+}
+
+void MultiGraph::process(venmodata* vdt) {
+  uint actor = store.findOrAdd(vdt->actor);
+  uint target = store.findOrAdd(vdt->target);
+  // pin both nodes, so that evictions in a layer cannot release them
+  // before the layer inserts the new edge
+  store.liveCount(actor)++;
+  if( actor != target ) {
+    store.liveCount(target)++;
+  }
+  for(std::size_t ii = 0; ii < layers.size(); ii++) {
+    layers[ii]->process(actor, target, vdt->epochtime);
+  }
+  if( vdt->epochtime > currtime ) {
+    currtime = vdt->epochtime;
+  }
+  // unpin, releasing nodes of a record too old for every window
+  if( 0 == --store.liveCount(actor) ) {
+    store.release(actor);
+  }
+  if( actor != target && 0 == --store.liveCount(target) ) {
+    store.release(target);
+  }
+}
+
+void MultiGraph::output() {
+  if( emit.due(currtime) ) {
+    std::string text;
+    for(std::size_t ii = 0; ii < layers.size(); ii++) {
+      if( ii > 0 ) {
+        text += " ";
+      }
+      text += emitter::format(layers[ii]->median2());
+    }
+    emit.putText(text);
+  }
+}
+
+void MultiGraph::setOutputMode(int mode, unsigned long every) {
+  emit.setMode(mode, every);
+}
+
+void MultiGraph::finishOutput() {
+  emit.finish();
+}
@@ -0,0 +1,137 @@
+#ifndef MULTIGRAPH_H
+#define MULTIGRAPH_H
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <time.h>       // time_t
+#include "venmodata.h"
+#include "venmoio.h"
+#include "emitter.h"
+#include "spill.h"
+
+// For convenience
+typedef unsigned int uint;
+
+// Marks the end of a bucket chain and unused ids
+#define NONODE 0xFFFFFFFFU
+
+// Dictionary of node names shared by all window layers. Every name is
+// stored once and known by a small integer id, so that layers keep
+// per node state in plain arrays indexed by id and edges become pairs
+// of ids. A node stays in the store while any layer holds an edge of it.
+class NameStore {
+protected:
+  std::vector<std::string> names;
+  // next id in same hash bucket, hash of name, layers with degree > 0
+  std::vector<uint> chain, hashes, live;
+  std::vector<uint> freeids;
+  std::vector<uint> buckets;
+  uint mask, count;
+  void rehash();
+
+public:
+  NameStore(uint nbuckets = 1 << 16);
+  // Id of name, registering it if new
+  uint findOrAdd(const std::string& name);
+  // Remove node, its id gets reused
+  void release(uint id);
+  const std::string& getName(uint id) const;
+  // Upper bound of ids handed out so far, for sizing per node arrays
+  uint idRange() const;
+  uint size() const;
+  // Number of layers in which node has edges, maintained by the layers
+  uint& liveCount(uint id);
+};
+
+// One time stamped edge entry in an eviction ring slot. Edges that are
+// refreshed leave their old entry behind, which is recognized as stale
+// because its time no longer matches the edge's current time.
+struct EdgeStamp {
+  unsigned long long key;
+  time_t time;
+};
+
+// Edges of one window length over the shared nodes: edge table, ring of
+// one slot per second for eviction, per node degrees, and degree
+// occupation histogram as in Graph. Same time semantics as Graph, i.e.
+// for a 60 second window it reproduces Graph's medians.
+class WindowLayer {
+protected:
+  NameStore* store;
+  uint window;
+  time_t currtime;
+  // live edges by id pair, with the time of their latest transaction,
+  // in memory also when spilling
+  std::unordered_map<unsigned long long, time_t> edges;
+  // most live edges so far, and the limit when spilling, 0 for none
+  std::size_t peakedges, maxedges;
+  std::vector< std::vector<EdgeStamp> > ring;
+  std::vector<uint> deg;
+  uint* degrees;
+  uint maxdeg, degsize;
+  // Slots more than hot seconds old written to spill, so that only
+  // records arriving late for them stay in memory, NULL to keep all
+  SpillStore* spill;
+  uint hot;
+  std::vector< std::vector<spillextent> > spilled;
+  std::vector<unsigned long long> spillbuf;
+  virtual void incDeg(uint id);
+  virtual void decDeg(uint id);
+  void evictSlot(uint slot);
+  void spillSlot(uint slot);
+
+public:
+  WindowLayer(NameStore* store, uint window);
+  virtual ~WindowLayer();
+  // Keep only the newest hot seconds of the ring in memory, writing
+  // older slots to mystore and streaming them back when evicted. Call
+  // before processing, mystore is not owned. Aborts when the window
+  // would hold more than myedges live edges, unless myedges is 0.
+  void setSpill(SpillStore* mystore, uint myhot, std::size_t myedges = 0);
+  // Evict edge key if its latest transaction is at time, also called
+  // back by SpillStore::stream
+  void evictKey(unsigned long long key, time_t time);
+  // Move the window up to epochtime, evicting what falls out of it.
+  // False if epochtime is a window or more older than the newest time.
+  bool advance(time_t epochtime);
+  void process(uint actor, uint target, time_t epochtime);
+  virtual void evictAll();
+  uint median2() const;
+  uint getWindow() const;
+  std::size_t edgesPeak() const;
+};
+
+// Engine computing medians over several window lengths at once from
+// one parse and one NameStore. Writes one line per record with one
+// median column per window, in the order the windows were given.
+class MultiGraph {
+protected:
+  venmoio* vio;
+  NameStore store;
+  std::vector<WindowLayer*> layers;
+  time_t currtime;
+  emitter emit;
+  // Cold seconds of all layers longer than hot, NULL unless setSpill
+  SpillStore* spill;
+  void clearLayers();
+
+public:
+  MultiGraph(venmoio* vio);
+  ~MultiGraph();
+  void setWindows(const std::vector<uint>& windows);
+  // Spill ring slots older than hot seconds of every longer window to
+  // segment files in dir, see SpillStore, call after setWindows. The
+  // live edges of each window stay in memory, at most edges of them.
+  void setSpill(const std::string& dir, uint hot, std::size_t edges = 0);
+  // Spilled bytes in total and most on disk at a time, 0 if not spilling
+  unsigned long long spillWritten() const;
+  unsigned long long spillPeak() const;
+  // Most live edges held in memory at a time by one window
+  std::size_t edgesPeak() const;
+  void process(venmodata* vdt);
+  void output();
+  void setOutputMode(int mode, unsigned long every = 1);
+  void finishOutput();
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// USDT probes of provider rolling_median, compiled in if the Makefile
+// finds sys/sdt.h (systemtap-sdt-dev), otherwise they expand to nothing.
+// A probe is a single nop in the code and a note in the ELF file, which
+// tracers like bpftrace and perf turn into a breakpoint when attached.
+// Arguments are only values at hand, so an unattached probe costs
+// about nothing. List them with
+//   bpftrace -l 'usdt:./rolling_median:*'
+// and see script/bpf for histograms made from them, script/bpf/smoke.sh
+// runs those. A value kept only for a probe is declared in PROBEVAR, e.g.
+//   PROBEVAR(bool done =) finish();
+// so that it does not exist without probes.
+//
+// record_parsed(epochtime)          valid record, by the parser
+// record_rejected(reason)           line or record dropped, reason is a
+//                                   string: syntax, duplicate, missing,
+//                                   time, length, amount or late
+// edge_inserted(sec, refreshed)     edge stored at second sec of the
+//                                   ring, refreshed 1 if it was in the
+//                                   window already
+// second_evicted(sec, edges)        second of the ring emptied
+// evict_all(edges)                  whole window dropped at once
+// median_emitted(median2, time)     twice the median written for the
+//                                   window ending at epoch time
+
+#ifdef HAVE_SDT
+#include <sys/sdt.h>
+#define PROBE1(name, a1) DTRACE_PROBE1(rolling_median, name, a1)
+#define PROBE2(name, a1, a2) DTRACE_PROBE2(rolling_median, name, a1, a2)
+#define PROBEVAR(decl) decl
+#else
+#define PROBE1(name, a1) do {} while( 0 )
+#define PROBE2(name, a1, a2) do {} while( 0 )
+#define PROBEVAR(decl)
+#endif
+
+#endif
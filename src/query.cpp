@@ -0,0 +1,123 @@
+#include <string>
+#include <chrono>
+#include <unistd.h>      // close, unlink, read
+#include <poll.h>
+#include <sys/socket.h>
+#include "snapshot.h"
+#include "query.h"
+
+// Milliseconds the server waits for a connection before it checks
+// whether it should stop, as for StatsServer
+#define SERVERPOLL 200
+
+
+bool QueryBox::ask(const std::string& myrequest, std::string& myanswer,
+                   int timeout) {
+  std::unique_lock<std::mutex> lock(mtx);
+  request = myrequest;
+  unsigned long long mine = ++asked;
+  pending.store(true, std::memory_order_relaxed);
+  bool ok = answered.wait_for(lock, std::chrono::milliseconds(timeout),
+    [this, mine] { return done == mine; });
+  if( ! ok ) {
+    pending.store(false, std::memory_order_relaxed);
+    return false;
+  }
+  myanswer = answer;
+  return true;
+}
+
+bool QueryBox::take(std::string& myrequest) {
+  std::lock_guard<std::mutex> lock(mtx);
+  if( ! pending.load(std::memory_order_relaxed) ) {
+    return false;
+  }
+  pending.store(false, std::memory_order_relaxed);
+  myrequest = request;
+  taken = asked;
+  return true;
+}
+
+void QueryBox::reply(const std::string& myanswer) {
+  std::lock_guard<std::mutex> lock(mtx);
+  if( taken == asked ) {
+    answer = myanswer;
+    done = taken;
+    answered.notify_one();
+  }
+}
+
+
+QueryServer::~QueryServer() {
+  stopping = true;
+  if( server.joinable() ) {
+    server.join();
+  }
+  if( fd >= 0 ) {
+    close(fd);
+    unlink(path.c_str());
+  }
+}
+
+void QueryServer::start() {
+  fd = StatsServer::listenLocal(path);
+  server = std::thread(&QueryServer::serve, this);
+}
+
+// Request up to newline or end of input, without carriage return,
+// false if the client sends nothing usable within QUERYWAIT
+bool QueryServer::readLine(int client, std::string& line) {
+  struct pollfd pfd;
+  pfd.fd = client;
+  pfd.events = POLLIN;
+  line.clear();
+  char buf[256];
+  while( line.length() < QUERYLINE ) {
+    if( poll(&pfd, 1, QUERYWAIT) <= 0 ) {
+      return false;
+    }
+    ssize_t count = read(client, buf, sizeof(buf));
+    if( count < 0 ) {
+      return false;
+    }
+    if( 0 == count ) {
+      break;
+    }
+    line.append(buf, count);
+    if( std::string::npos != line.find('\n') ) {
+      break;
+    }
+  }
+  line = line.substr(0, line.find('\n'));
+  if( ! line.empty() && '\r' == line[line.length() - 1] ) {
+    line.resize(line.length() - 1);
+  }
+  return ! line.empty();
+}
+
+// Server thread body: one request per connection, then hang up
+void QueryServer::serve() {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  while( ! stopping ) {
+    if( poll(&pfd, 1, SERVERPOLL) <= 0 ) {
+      continue;
+    }
+    int client = accept(fd, NULL, NULL);
+    if( client < 0 ) {
+      continue;
+    }
+    std::string request, answer;
+    if( ! readLine(client, request) ) {
+      answer = "error no request\n";
+    } else if( ! box.ask(request, answer) ) {
+      answer = "error busy\n";
+    }
+    // a client that went away costs nothing but the failed write
+    ssize_t written = send(client, answer.data(), answer.length(),
+      MSG_NOSIGNAL);
+    (void) written;
+    close(client);
+  }
+}
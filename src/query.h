@@ -0,0 +1,68 @@
+#ifndef QUERY_H
+#define QUERY_H
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Milliseconds a query waits for the graph thread to answer
+#define QUERYWAIT 1000
+
+// Longest request line
+#define QUERYLINE 1024
+
+// Hands one request at a time from a server thread to the graph thread,
+// which owns the graph and answers between records, and the answer back.
+// The graph thread only checks a relaxed atomic flag per record and
+// takes the lock when a request is waiting, so queries cost ingestion
+// nothing while there are none.
+class QueryBox {
+protected:
+  std::mutex mtx;
+  std::condition_variable answered;
+  std::atomic<bool> pending;
+  std::string request, answer;
+  // numbers of the last request asked, taken and answered, so that a
+  // late answer to a request given up on is dropped
+  unsigned long long asked, taken, done;
+
+public:
+  QueryBox(): pending(false), asked(0), taken(0), done(0) {};
+  // Server thread: post request and wait up to timeout milliseconds,
+  // false if it was not answered by then
+  bool ask(const std::string& myrequest, std::string& myanswer,
+           int timeout = QUERYWAIT);
+  // Graph thread: whether a request waits, cheap enough for every record
+  bool waiting() const { return pending.load(std::memory_order_relaxed); }
+  // Graph thread: take the waiting request, false if there is none
+  bool take(std::string& myrequest);
+  // Graph thread: answer the request taken last
+  void reply(const std::string& myanswer);
+};
+
+// Reads one request line from each connection to a local UNIX domain
+// socket, passes it through box and writes back the answer, e.g.
+//   echo "neighbors user-42" | nc -U <path>
+// Requests wait for the graph thread, so they are answered only while
+// records arrive, others get "error busy". Runs on its own thread until
+// destroyed, which also removes the socket.
+class QueryServer {
+protected:
+  QueryBox& box;
+  std::string path;
+  int fd;
+  std::atomic<bool> stopping;
+  std::thread server;
+  void serve();
+  bool readLine(int client, std::string& line);
+
+public:
+  QueryServer(QueryBox& box, const std::string& path):
+    box(box), path(path), fd(-1), stopping(false) {};
+  ~QueryServer();
+  // Bind the socket, replacing a stale one, and start answering
+  void start();
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include <vector>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>       // SCHED_IDLE
+#include "hashtable.h"
+#include "reclaim.h"
+
+
+Reclaimer::Reclaimer(std::size_t limit):
+  pendingweight(0), limit(limit ? limit : 1), queued(0), peak(0),
+  closed(false) {
+  batchweight = (limit < RECLAIMBATCH) ? limit : RECLAIMBATCH;
+  if( 0 == batchweight ) {
+    batchweight = 1;
+  }
+  worker = std::thread(&Reclaimer::freeAll, this);
+#ifdef SCHED_IDLE
+  // run only on otherwise idle cores, so freeing never preempts the
+  // evicting thread, which yields to it when limit is reached
+  struct sched_param param;
+  param.sched_priority = 0;
+  pthread_setschedparam(worker.native_handle(), SCHED_IDLE, &param);
+#endif
+}
+
+// Free what is left, then stop the background thread
+Reclaimer::~Reclaimer() {
+  handOver();
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    closed = true;
+    notempty.notify_all();
+  }
+  worker.join();
+}
+
+void Reclaimer::retire(Content* content, bool deep, std::size_t weight) {
+  retired item = {content, deep};
+  pending.push_back(item);
+  pendingweight += weight;
+  if( pendingweight >= batchweight ) {
+    handOver();
+  }
+}
+
+void Reclaimer::handOver() {
+  if( pending.empty() ) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mtx);
+  while( queued > 0 && queued + pendingweight > limit ) {
+    notfull.wait(lock);
+  }
+  batches.push_back(std::vector<retired>());
+  batches.back().swap(pending);
+  weights.push_back(pendingweight);
+  queued += pendingweight;
+  if( queued > peak ) {
+    peak = queued;
+  }
+  pendingweight = 0;
+  notempty.notify_one();
+}
+
+std::size_t Reclaimer::highWater() {
+  std::lock_guard<std::mutex> lock(mtx);
+  return peak;
+}
+
+std::size_t Reclaimer::waiting() {
+  std::lock_guard<std::mutex> lock(mtx);
+  return queued + pendingweight;
+}
+
+// Background thread body
+void Reclaimer::freeAll() {
+  std::unique_lock<std::mutex> lock(mtx);
+  while( true ) {
+    while( ! closed && batches.empty() ) {
+      notempty.wait(lock);
+    }
+    if( batches.empty() ) {
+      return;
+    }
+    std::vector<retired> batch;
+    batch.swap(batches.front());
+    batches.pop_front();
+    std::size_t weight = weights.front();
+    weights.pop_front();
+    lock.unlock();
+    for(std::size_t ii = 0; ii < batch.size(); ii++) {
+      dispose(batch[ii]);
+    }
+    lock.lock();
+    queued -= weight;
+    notfull.notify_one();
+  }
+}
+
+void Reclaimer::dispose(const retired& item) {
+  if( item.deep ) {
+    Hashtable* table = static_cast<Hashtable*>(item.content);
+    for(std::size_t hash = 0; hash < table->getSize(); hash++) {
+      List* mylist = static_cast<List*>(table->getContent(hash));
+      while( NULL != mylist ) {
+        List* next = mylist->getNext();
+        delete mylist->getContent();
+        delete mylist;
+        mylist = next;
+      }
+    }
+  }
+  delete item.content;
+}
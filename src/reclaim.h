@@ -0,0 +1,56 @@
+#ifndef RECLAIM_H
+#define RECLAIM_H
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "hashtable.h"
+
+// Objects handed over at a time, unless the limit is smaller
+#define RECLAIMBATCH 1024
+
+// Object waiting to be freed: a single list item, node, edge or table,
+// or with deep set a hash table of lists together with all lists and
+// their contents
+struct retired {
+  Content* content;
+  bool deep;
+};
+
+// Frees evicted graph objects on a background thread, so that the
+// thread evicting them only unlinks them and appends them to a batch.
+// Full batches go to the background thread. At most limit objects wait
+// to be freed at any time, beyond that handing over a batch waits for
+// the background thread to catch up, which bounds the memory held by
+// evicted objects. A single hand over larger than limit, e.g. all
+// tables of Graph::evictAll, is let through once everything before it
+// is freed.
+class Reclaimer {
+protected:
+  std::vector<retired> pending;
+  std::size_t pendingweight, batchweight, limit, queued, peak;
+  std::deque< std::vector<retired> > batches;
+  std::deque<std::size_t> weights;
+  bool closed;
+  std::mutex mtx;
+  std::condition_variable notfull, notempty;
+  std::thread worker;
+  void freeAll();
+  void handOver();
+  static void dispose(const retired& item);
+
+public:
+  Reclaimer(std::size_t limit);
+  ~Reclaimer();
+  // Free content on the background thread. Weight is the number of
+  // objects it stands for, all of a deep table's lists and contents.
+  void retire(Content* content, bool deep = false, std::size_t weight = 1);
+  // Most objects that waited to be freed at one time so far
+  std::size_t highWater();
+  // Objects waiting to be freed now
+  std::size_t waiting();
+};
+
+#endif
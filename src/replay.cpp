@@ -0,0 +1,144 @@
+#include <string>
+#include <vector>
+#include <cstdlib>       // strtod
+#include <cstring>       // strncmp
+#include <chrono>
+#include "venmodata.h"
+#include "venmoio.h"
+#include "latency.h"
+#include "replay.h"
+#include "stringutils.h"
+
+// Most records handed over in one burst
+#define REPLAYBLOCK 256
+
+
+// Destructor stops a pacer that is still running, e.g. on early exit
+venmoreplay::~venmoreplay() {
+  queue.close();
+  if( pacer.joinable() ) {
+    pacer.join();
+  }
+}
+
+void venmoreplay::setPace(double myspeed, double myrate) {
+  speed = myspeed;
+  rate = myrate;
+}
+
+void venmoreplay::setSymmetric(bool mysymmetric) {
+  symmetric = mysymmetric;
+}
+
+void venmoreplay::setWide(bool mywide) {
+  wide = mywide;
+}
+
+void venmoreplay::setAmounts(bool myamounts) {
+  amounts = myamounts;
+}
+
+// Launch pacer thread
+void venmoreplay::start() {
+  pacer = std::thread(&venmoreplay::paceAll, this);
+}
+
+bool venmoreplay::next(std::vector<replayrecord>& block) {
+  return queue.pop(block);
+}
+
+// Hand over records collected so far, all stamped with the same time
+bool venmoreplay::flush(std::vector<replayrecord>& block) {
+  if( block.empty() ) {
+    return true;
+  }
+  unsigned long long now = latency::now();
+  for(std::size_t ii = 0; ii < block.size(); ii++) {
+    block[ii].enqueued = now;
+  }
+  if( ! queue.push(std::move(block)) ) {
+    return false;
+  }
+  block = std::vector<replayrecord>();
+  block.reserve(REPLAYBLOCK);
+  return true;
+}
+
+// Pacer thread body: parse valid records like venmofeed, wait for each
+// one to become due, collect those already due into one burst
+void venmoreplay::paceAll() {
+  venmoio vio;
+  vio.setSymmetric(symmetric);
+  vio.setWide(wide);
+  vio.setAmounts(amounts);
+  if( ! vio.openInput(file.c_str()) ) {
+    stu::abortf("Cannot read input file %s\n", file.c_str());
+  }
+  venmodata vdt("", "", "");
+  std::vector<replayrecord> block;
+  block.reserve(REPLAYBLOCK);
+  unsigned long long started = 0, due = 0, count = 0;
+  time_t firsttime = 0;
+  while( vio.parseLine(&vdt) ) {
+    if( vdt.FlagAll != vdt.supplied ) {
+      continue;
+    }
+    unsigned long long offset;
+    if( 0 == count ) {
+      started = latency::now();
+      firsttime = vdt.epochtime;
+      offset = 0;
+    } else if( rate > 0 ) {
+      offset = (unsigned long long)(count * 1e9 / rate);
+    } else {
+      double secs = (double)(vdt.epochtime - firsttime) / speed;
+      offset = (secs > 0) ? (unsigned long long)(secs * 1e9) : 0;
+    }
+    count++;
+    // out of order records are due right after their predecessor
+    if( started + offset > due ) {
+      due = started + offset;
+    }
+    if( due > latency::now() ) {
+      // hand over what is due before waiting for this one
+      if( ! flush(block) ) {
+        return;
+      }
+      // latency::now is the steady clock in nanoseconds
+      std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+        std::chrono::nanoseconds(due)));
+    }
+    block.push_back(replayrecord(vdt, due));
+    if( block.size() >= REPLAYBLOCK && ! flush(block) ) {
+      return;
+    }
+  }
+  if( flush(block) ) {
+    queue.close();
+  }
+}
+
+bool venmoreplay::parsePace(const char* spec, double& myspeed,
+                            double& myrate) {
+  const char* value;
+  if( 0 == strncmp(spec, "speed:", 6) ) {
+    value = spec + 6;
+  } else if( 0 == strncmp(spec, "rate:", 5) ) {
+    value = spec + 5;
+  } else {
+    return false;
+  }
+  char* end;
+  double number = strtod(value, &end);
+  if( end == value || '\0' != *end || !(number > 0) || number > 1e12 ) {
+    return false;
+  }
+  if( 's' == spec[0] ) {
+    myspeed = number;
+    myrate = 0.0;
+  } else {
+    myspeed = 1.0;
+    myrate = number;
+  }
+  return true;
+}
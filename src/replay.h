@@ -0,0 +1,61 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+#include <string>
+#include <vector>
+#include <thread>
+#include "venmodata.h"
+#include "blockqueue.h"
+
+// Record handed over by venmoreplay with the monotonic times, see
+// latency::now, at which it was due to arrive and at which it was
+// actually put into the queue
+struct replayrecord {
+  venmodata vdt;
+  unsigned long long due, enqueued;
+  replayrecord(const venmodata& vdt, unsigned long long due):
+    vdt(vdt), due(due), enqueued(0) {};
+};
+
+// Replays an input file in real time: a pacer thread parses records and
+// releases each one when it is due, either at created_time scaled by a
+// speed factor, relative to the first record, or at a fixed rate. Due
+// times never go backwards, so late records arrive in file order, right
+// after their predecessor. Records that are due together, e.g. all of
+// one second of created_time, arrive as one burst. Latency measured
+// from enqueued misses the time a record waited while the pacer itself
+// was held up by a full queue, latency from due includes it, which
+// corrects for coordinated omission. It also includes the few tens of
+// microseconds the pacer takes to wake up when a record is due.
+class venmoreplay {
+protected:
+  std::string file;
+  BlockQueue< std::vector<replayrecord> > queue;
+  std::thread pacer;
+  // created_time seconds per second, or 0 if paced by rate
+  double speed;
+  // records per second if paced by rate
+  double rate;
+  bool symmetric, wide, amounts;
+  void paceAll();
+  bool flush(std::vector<replayrecord>& block);
+
+public:
+  venmoreplay(const std::string& file, std::size_t nblocks = 64):
+    file(file), queue(nblocks), speed(1.0), rate(0.0), symmetric(true),
+    wide(false), amounts(false) {};
+  ~venmoreplay();
+  // Pace as parsed by parsePace, call before start
+  void setPace(double myspeed, double myrate);
+  void setSymmetric(bool mysymmetric);
+  void setWide(bool mywide);
+  void setAmounts(bool myamounts);
+  void start();
+  // Next burst of records, false once the input is exhausted
+  bool next(std::vector<replayrecord>& block);
+
+  // Parse "speed:F" for created_time F times faster than real time, or
+  // "rate:N" for N records per second
+  static bool parsePace(const char* spec, double& myspeed, double& myrate);
+};
+
+#endif
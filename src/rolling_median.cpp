@@ -1,40 +1,893 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>      // strtoul strtoll
+#include <getopt.h>
+#include <libgen.h>
+#include "epochtime.h"
 #include "venmodata.h"
 #include "venmoio.h"
+#include "venmofeed.h"
+#include "merge.h"
+#include "latency.h"
+#include "emitter.h"
+#include "binout.h"
+#include "snapshot.h"
+#include "query.h"
+#include "replay.h"
 #include "hashtable.h"
+#include "memory.h"
+#include "amounts.h"
 #include "graph.h"
+#include "tgraph.h"
+#include "multigraph.h"
+#include "approxgraph.h"
+#include "shard.h"
+#include "timeindex.h"
 #include "stringutils.h"
 
+// Command line options shared by all modes
+struct runopts {
+  const char* outdir;
+  bool stats, directed, components;
+  // records with further Json fields, see venmoio::parseWide
+  bool wide;
+  int emitmode;
+  unsigned long emitevery;
+  std::vector<uint> windows;
+  uint topk;
+  unsigned long topevery;
+  std::size_t budget;
+  uint batch;
+  // binary output column mask, 0 for text
+  unsigned int bincolumns;
+  // statistics published for --query, NULL if not requested
+  StatsSnapshot* snapshot;
+  // --replay pace as of venmoreplay::parsePace, speed 0 if not replaying
+  double speed, rate;
+  // worker processes of the sharded engine
+  uint shards;
+  // most evicted objects waiting for the background thread, 0 to free
+  // them right away
+  std::size_t reclaim;
+  // degree and neighbor requests of --adjacency, NULL if not requested
+  QueryBox* queries;
+  // --spill directory, empty if not spilling, seconds kept in memory
+  // and most live edges per window, 0 for no limit
+  std::string spilldir;
+  uint spillhot;
+  std::size_t spilledges;
+  // --start-at epoch time, if seek is set
+  bool seek;
+  long long startat;
+  // inputs are feeds merged by time into one output
+  bool merge;
+  // --memory budget in bytes, 0 for none, and its action of memory.h
+  std::size_t memlimit;
+  int memaction;
+  // --amounts quantiles written after each median, empty for none
+  std::vector<double> quantiles;
+  runopts(): outdir(NULL), stats(false), directed(false), components(false),
+    wide(false), emitmode(EMIT_ALL), emitevery(1), topk(0),
+    topevery(1000), budget(1 << 22), batch(0), bincolumns(0),
+    snapshot(NULL), speed(0.0), rate(0.0), shards(0), reclaim(0),
+    queries(NULL), spillhot(MAXSEC), spilledges(0),
+    seek(false), startat(0),
+    merge(false), memlimit(0), memaction(MEM_WARN) {};
+};
 
-int main(int argc, char* argv[]) {
+// Apply options to a freshly constructed engine
+template <class Engine>
+void configure(Engine& grp, const runopts& opts) {
+  grp.setOutputMode(opts.emitmode, opts.emitevery);
+  grp.setOutputFormat(opts.bincolumns);
+  grp.publishStats(opts.snapshot);
+}
+
+void configure(Graph& grp, const runopts& opts) {
+  if( opts.topk > 0 ) {
+    grp.trackHubs();
+  }
+  if( opts.components ) {
+    grp.trackComponents();
+  }
+  if( opts.reclaim > 0 ) {
+    grp.reclaimMemory(opts.reclaim);
+  }
+  if( NULL != opts.queries ) {
+    grp.trackNeighbors();
+    grp.answerQueries(opts.queries);
+  }
+  if( opts.memlimit > 0 ) {
+    grp.limitMemory(opts.memlimit, opts.memaction);
+  }
+  if( ! opts.quantiles.empty() ) {
+    grp.trackAmounts(opts.quantiles);
+  }
+  grp.setOutputMode(opts.emitmode, opts.emitevery);
+  grp.setOutputFormat(opts.bincolumns);
+  grp.publishStats(opts.snapshot);
+}
+
+void configure(MultiGraph& grp, const runopts& opts) {
+  grp.setWindows(opts.windows);
+  if( ! opts.spilldir.empty() ) {
+    grp.setSpill(opts.spilldir, opts.spillhot, opts.spilledges);
+  }
+  grp.setOutputMode(opts.emitmode, opts.emitevery);
+}
+
+void configure(ApproxGraph& grp, const runopts& opts) {
+  if( ! opts.windows.empty() ) {
+    grp.setWindow(opts.windows[0]);
+  }
+  grp.setBudget(opts.budget);
+  grp.setOutputMode(opts.emitmode, opts.emitevery);
+}
+
+void configure(ShardedGraph& grp, const runopts& opts) {
+  grp.setShards(opts.shards);
+  grp.setOutputMode(opts.emitmode, opts.emitevery);
+}
+
+// Announce records about to be processed, only the classic engine
+// prefetches for them
+template <class Engine>
+void prefetch(Engine& grp, venmodata* vdts, std::size_t count) {}
+
+void prefetch(Graph& grp, venmodata* vdts, std::size_t count) {
+  grp.prefetchBatch(vdts, count);
+}
+
+// Summary after the last record, only the approximate engine and the
+// classic one freeing memory in the background or under a memory budget
+// have one
+template <class Engine>
+void report(const Engine& grp) {}
+
+void report(const MultiGraph& grp) {
+  if( grp.spillWritten() > 0 ) {
+    std::cerr << "spill: " << (grp.spillWritten() >> 10) << " KiB written, "
+      << "at most " << (grp.spillPeak() >> 10) << " KiB on disk, "
+      << "at most " << grp.edgesPeak() << " live edges in memory"
+      << std::endl;
+  }
+}
+
+void report(const ApproxGraph& grp) {
+  std::cerr << "approx: tracking 1 in " << (1ULL << grp.getLevel())
+    << " nodes, " << grp.trackedNodes() << " nodes tracked" << std::endl
+    << "approx: median rank error at most " << grp.worstRankError(0.01)
+    << " for each median written, at 99% confidence" << std::endl;
+}
+
+void report(const Graph& grp) {
+  if( grp.reclaimHighWater() > 0 ) {
+    std::cerr << "reclaim: at most " << grp.reclaimHighWater()
+      << " evicted objects waited to be freed" << std::endl;
+  }
+  if( NULL != grp.memoryBudget() ) {
+    std::cerr << "memory: at most " << (grp.memoryBudget()->getPeak() >> 10)
+      << " KiB counted of " << (grp.memoryBudget()->getBudget() >> 10)
+      << " KiB budget" << std::endl;
+  }
+  if( NULL != grp.approximation() ) {
+    report(*grp.approximation());
+  }
+}
+
+
+void usage(const char* prog) {
+  stu::abortf("usage: %s <inputfile> <outputfile>\n"
+    "   or: %s --outdir <dir> <input>...\n"
+    "   or: %s --merge <input>... <outputfile>\n"
+    "  -o, --outdir <dir>  process inputs (files or directories of files)\n"
+    "                      as one stream, writing one output per input\n"
+    "  -M, --merge         parse inputs (files or directories of files),\n"
+    "                      each sorted by created_time, concurrently and\n"
+    "                      merge them by time into one stream, see merge.h\n"
+    "  -S, --stats         report throughput and per record latency of\n"
+    "                      parsing, processing and output on stderr\n"
+    "  -e, --engine <e>    graph engine: classic (default), static, the\n"
+    "                      compile-time specialized engine of tgraph.h, or\n"
+    "                      approx, bounded memory with a median rank error\n"
+    "                      bound reported on stderr, see approxgraph.h\n"
+    "  -b, --budget <n>    nodes, edges and ring entries the approx engine\n"
+    "                      may hold (4194304), its window is the first of\n"
+    "                      --windows if given\n"
+    "  -L, --memory <bytes>[:<action>] estimate the bytes held by the\n"
+    "                      window from object sizes, without allocator\n"
+    "                      overhead, every 1024 records, budget with\n"
+    "                      optional K, M or G suffix, and near it warn\n"
+    "                      (default), compact, or approx to continue on\n"
+    "                      the approx engine, see memory.h (classic engine)\n"
+    "  -A, --amounts <list> after each median write the given quantiles,\n"
+    "                      e.g. 0.5,0.9, of the optional \"amount\" of\n"
+    "                      records in the window, implies --wide, see\n"
+    "                      amounts.h (classic engine). Amounts are read\n"
+    "                      as binary floating point and rounded to whole\n"
+    "                      cents, so 1.005 gives 1.00. Records with an\n"
+    "                      amount below 0 or no number are rejected\n"
+    "  -c, --components    after each median write the number of connected\n"
+    "                      components and the size of the largest one\n"
+    "                      (classic engine)\n"
+    "  -F, --format <f>    output format: text (default), or bin with\n"
+    "                      optional extra columns, e.g. bin:edges,nodes,epoch,\n"
+    "                      see binout.h and medconv (classic and static\n"
+    "                      engines)\n"
+    "  -Q, --query <path>  answer connections to UNIX socket path with the\n"
+    "                      latest median, nodes, edges and maximum degree,\n"
+    "                      see snapshot.h (classic and static engines)\n"
+    "  -a, --adjacency <path> keep each node's edges and answer requests\n"
+    "                      \"degree <name>\" and \"neighbors <name>\" on\n"
+    "                      UNIX socket path, see query.h (classic engine)\n"
+    "  -R, --replay <pace> replay inputfile in real time, paced by\n"
+    "                      created_time as speed:F (F times real time) or\n"
+    "                      at rate:N records per second, and report arrival\n"
+    "                      to output latency on stderr, see replay.h\n"
+    "  -N, --shards <n>    spread the graph over n worker processes by node,\n"
+    "                      merging their degree histograms, same output,\n"
+    "                      see shard.h\n"
+    "  -r, --reclaim <n>   free evicted nodes and edges on a background\n"
+    "                      thread, with at most n waiting (classic engine)\n"
+    "  -T, --start-at <t>  write medians from the first record at or after\n"
+    "                      t (UTC as in created_time, or epoch seconds),\n"
+    "                      reading the input only from one window before,\n"
+    "                      found by the index of timeindex if there is one,\n"
+    "                      see timeindex.h\n"
+    "  -B, --batch <k>     hash k records ahead and prefetch the table\n"
+    "                      buckets they visit (classic engine), same output\n"
+    "  -W, --wide          accept records with any further Json fields,\n"
+    "                      also nested ones, which are skipped\n"
+    "  -D, --directed      count (actor, target) and (target, actor) as\n"
+    "                      different edges, requires --engine static\n"
+    "  -m, --emit <mode>   which medians to write: all (default), change\n"
+    "                      (record index and median when it changes),\n"
+    "                      every:N (every N-th record), seconds:T (first\n"
+    "                      record of every T seconds) or rle (run length\n"
+    "                      and median of runs of equal medians)\n"
+    "  -w, --windows <list> comma separated window lengths in seconds,\n"
+    "                      e.g. 60,300,3600: one parse and one node store\n"
+    "                      feed all windows, one median column each\n"
+    "  -s, --spill <dir>[:<hot>[:<edges>]] keep only the newest hot (60)\n"
+    "                      seconds of the eviction ring of each longer\n"
+    "                      window in memory, spilling older seconds to\n"
+    "                      files in dir, see spill.h (--windows). The\n"
+    "                      table of live edges, about 40 bytes per\n"
+    "                      distinct edge in the window, stays in memory,\n"
+    "                      abort if it exceeds edges (no limit)\n"
+    "  -t, --top <k>[:<n>] every n (default 1000) records, list the k\n"
+    "                      highest degree nodes with their degrees on\n"
+    "                      stderr, requires --engine classic\n",
+    prog, prog, prog);
+}
+
+// Throughput and latency bookkeeping for --stats, inactive otherwise
+class runstats {
+protected:
+  LatencyHistogram hist;
+  unsigned long long started, tick;
+  bool active;
+public:
+  runstats(bool active): active(active) {
+    if( active ) {
+      started = tick = latency::now();
+    }
+  };
+  // Record time since previous call, for one record if counted
+  void lap(bool counted) {
+    if( active ) {
+      unsigned long long tock = latency::now();
+      if( counted ) {
+        hist.record(tock - tick);
+      }
+      tick = tock;
+    }
+  };
+  void print() {
+    if( active ) {
+      double secs = (latency::now() - started) * 1e-9;
+      std::cerr << "records " << hist.getCount() << " seconds " << secs
+        << " throughput " << hist.getCount() / secs << " records/s"
+        << std::endl << "latency_us " << hist.summary(1000.0) << std::endl;
+    }
+  };
+};
 
-  // Expect two command line parameters, input and output filenames
-  if(argc != 3) {
-    stu::abortf("usage: %s <inputfile> <outputfile>\n", argv[0]);
+// Periodic listing of the highest degree nodes for --top, on stderr
+class hubreport {
+protected:
+  uint topk;
+  unsigned long every, count;
+  std::vector<Node*> hubs;
+public:
+  hubreport(const runopts& opts):
+    topk(opts.topk), every(opts.topevery), count(0) {};
+  // Only the classic engine tracks hubs
+  template <class Engine>
+  void tick(Engine& grp) {};
+  void tick(Graph& grp) {
+    if( topk > 0 && 0 == ++count % every ) {
+      grp.topHubs(topk, hubs);
+      std::cerr << "top " << count << ":";
+      for(std::size_t ii = 0; ii < hubs.size(); ii++) {
+        std::cerr << " " << hubs[ii]->getStr() << "(" << hubs[ii]->getDeg()
+          << ")";
+      }
+      std::cerr << std::endl;
+    }
+  };
+};
+
+// Holds back output for --start-at until the first record at or after
+// the start time, records before that only fill the window
+class startgate {
+protected:
+  bool warming;
+  long long startat;
+public:
+  startgate(const runopts& opts): warming(opts.seek), startat(opts.startat) {};
+  bool open(const venmodata& vdt) {
+    if( warming && vdt.epochtime >= startat ) {
+      warming = false;
+    }
+    return ! warming;
+  }
+};
+
+// Skip input lines that cannot matter for --start-at: those before the
+// longest window ending at the start time
+void seekStart(venmoio& vio, const runopts& opts, const char* infname) {
+  long long window = MAXSEC, offset;
+  for(std::size_t ii = 0; ii < opts.windows.size(); ii++) {
+    if( opts.windows[ii] > window ) {
+      window = opts.windows[ii];
+    }
+  }
+  if( ! TimeIndex::findStart(infname, opts.startat - window, MAXSEC, offset)
+      || ! vio.seekInput(offset) ) {
+    stu::abortf("Cannot seek in input file %s, --start-at needs an "
+      "uncompressed file\n", infname);
   }
+}
+
+// Process and output valid records in order, in batches of opts.batch
+// records announced to the engine first if batches are enabled
+template <class Engine>
+void processRecords(Engine& grp, const runopts& opts, venmodata* vdts,
+                    std::size_t count, hubreport& hrp, runstats& rst,
+                    startgate& gate) {
+  std::size_t step = opts.batch ? opts.batch : count;
+  for(std::size_t start = 0; start < count; start += step) {
+    std::size_t len = (count - start < step) ? count - start : step;
+    if( opts.batch ) {
+      prefetch(grp, vdts + start, len);
+    }
+    for(std::size_t ii = start; ii < start + len; ii++) {
+      grp.process(&vdts[ii]);
+      if( gate.open(vdts[ii]) ) {
+        grp.output();
+      }
+      hrp.tick(grp);
+      rst.lap(true);
+    }
+  }
+}
 
+// Single input file, single output file
+template <class Engine>
+void runSingle(const runopts& opts, const char* infname, const char* outfname) {
   // bash command line is limited size and we are using run script,
   // so command line parameters not sanitized
   // opens files and creates output directory of needed
-  venmoio vio(argv[1], argv[2]);
+  venmoio vio(infname, outfname);
+  vio.setSymmetric(! opts.directed);
+  vio.setWide(opts.wide);
+  if( opts.seek ) {
+    seekStart(vio, opts, infname);
+  }
 
   // Initialize data structures for processing
-  Graph grp(&vio);
+  Engine grp(&vio);
+  configure(grp, opts);
+  startgate gate(opts);
 
   // object that holds json data and flag showing which elements were
   // supplied, see venmodata.h
   venmodata vdt("", "", "");
+  runstats rst(opts.stats);
+  hubreport hrp(opts);
+
+  if( opts.batch > 0 ) {
+    // parse a batch of valid records ahead of processing them
+    std::vector<venmodata> records(opts.batch, vdt);
+    bool more = true;
+    while( more ) {
+      std::size_t count = 0;
+      while( count < records.size() && (more = vio.parseLine(&records[count])) ) {
+        if( vdt.FlagAll == records[count].supplied ) {
+          count++;
+        } else {
+          rst.lap(false);
+        }
+      }
+      processRecords(grp, opts, &records[0], count, hrp, rst, gate);
+    }
+  }
 
   // vio.parseLine() reads a line and fills elements of vdt
-  while( vio.parseLine(&vdt) ) {
+  while( 0 == opts.batch && vio.parseLine(&vdt) ) {
     if( vdt.FlagAll == vdt.supplied ) {
       // debug output
 //       vdt.cout();
       grp.process(&vdt);
-      grp.output();
+      if( gate.open(vdt) ) {
+        grp.output();
+      }
       // debug output
 //       grp.test_output();
+      hrp.tick(grp);
+      rst.lap(true);
+    } else {
+      rst.lap(false);
+    }
+  }
+  grp.finishOutput();
+  report(grp);
+  rst.print();
+}
+
+// Output file in outdir of an input file: its basename, without the
+// suffix of a compressed input, as outputs are uncompressed
+std::string outputName(const char* outdir, const std::string& inname) {
+  // basename may modify its argument, so hand it a copy
+  std::vector<char> namebuf(inname.begin(), inname.end());
+  namebuf.push_back('\0');
+  std::string outname = basename(&namebuf[0]);
+  const char* suffixes[] = {".gz", ".zst"};
+  for(int ii = 0; ii < 2; ii++) {
+    std::string suffix = suffixes[ii];
+    if( outname.length() > suffix.length() && 0 == outname.compare(
+        outname.length() - suffix.length(), suffix.length(), suffix) ) {
+      outname.resize(outname.length() - suffix.length());
+    }
+  }
+  return std::string(outdir) + "/" + outname;
+}
+
+// Several input files processed as one logical stream: the graph, and
+// with it the last minute of transactions, carries over file boundaries.
+// A helper thread parses upcoming files while the graph works on the
+// current one. Each input file gets an output file of the same name
+// in outdir. Inputs that would share an output file, like a/x.json and
+// b/x.json, or x.json and x.json.gz, are refused before any is read.
+template <class Engine>
+void runFiles(const runopts& opts, std::vector<std::string>& infiles) {
+  std::vector<std::string> outfiles;
+  std::map<std::string, std::size_t> owner;
+  for(std::size_t ii = 0; ii < infiles.size(); ii++) {
+    outfiles.push_back(outputName(opts.outdir, infiles[ii]));
+    std::pair<std::map<std::string, std::size_t>::iterator, bool> res =
+      owner.insert(std::make_pair(outfiles[ii], ii));
+    if( ! res.second ) {
+      stu::abortf("Inputs %s and %s would both write %s\n",
+        infiles[res.first->second].c_str(), infiles[ii].c_str(),
+        outfiles[ii].c_str());
+    }
+  }
+  venmoio vio;
+  runstats rst(opts.stats);
+  hubreport hrp(opts);
+  Engine grp(&vio);
+  configure(grp, opts);
+  startgate gate(opts);
+  venmofeed feed(infiles);
+  feed.setSymmetric(! opts.directed);
+  feed.setWide(opts.wide);
+  feed.setAmounts(! opts.quantiles.empty());
+  feed.start();
+
+  venmoblock block;
+  while( feed.next(block) ) {
+    if( block.first ) {
+      // complete output of previous file
+      grp.finishOutput();
+      vio.openOutput(outfiles[block.file].c_str());
+    }
+    if( ! block.records.empty() ) {
+      processRecords(grp, opts, &block.records[0], block.records.size(),
+        hrp, rst, gate);
+    }
+  }
+  grp.finishOutput();
+  report(grp);
+  rst.print();
+}
+
+// Several feeds, each in time order, merged into one stream by time
+// while they are parsed, see merge.h. A feed is a file or a directory
+// of files read one after the other.
+template <class Engine>
+void runMerge(const runopts& opts, int nargs, char* args[],
+              const char* outfname) {
+  venmoio vio;
+  vio.openOutput(outfname);
+  Engine grp(&vio);
+  configure(grp, opts);
+  startgate gate(opts);
+  runstats rst(opts.stats);
+  hubreport hrp(opts);
+  std::vector< std::vector<std::string> > inputs(nargs);
+  for(int ii = 0; ii < nargs; ii++) {
+    venmofeed::listInputs(args[ii], inputs[ii]);
+  }
+  venmomerge merge(inputs);
+  merge.setSymmetric(! opts.directed);
+  merge.setWide(opts.wide);
+  merge.setAmounts(! opts.quantiles.empty());
+  merge.start();
+
+  venmodata* vdt;
+  while( merge.next(vdt) ) {
+    grp.process(vdt);
+    if( gate.open(*vdt) ) {
+      grp.output();
+    }
+    hrp.tick(grp);
+    rst.lap(true);
+  }
+  grp.finishOutput();
+  report(grp);
+  rst.print();
+}
+
+// Input file replayed in real time as paced by opts, see replay.h.
+// Reports throughput and the latency from each record's arrival to the
+// end of its output on stderr, both from the time the record was put
+// into the queue and from the time it was due, which also counts the
+// records the pacer could not deliver on time while the engine lagged.
+template <class Engine>
+void runReplay(const runopts& opts, const char* infname,
+               const char* outfname) {
+  venmoio vio;
+  vio.openOutput(outfname);
+  Engine grp(&vio);
+  configure(grp, opts);
+  runstats rst(opts.stats);
+  hubreport hrp(opts);
+  venmoreplay replay(infname);
+  replay.setPace(opts.speed, opts.rate);
+  replay.setSymmetric(! opts.directed);
+  replay.setWide(opts.wide);
+  replay.setAmounts(! opts.quantiles.empty());
+  LatencyHistogram fromqueue, fromdue;
+  unsigned long long started = latency::now();
+  replay.start();
+
+  std::vector<replayrecord> block;
+  while( replay.next(block) ) {
+    for(std::size_t ii = 0; ii < block.size(); ii++) {
+      grp.process(&block[ii].vdt);
+      grp.output();
+      hrp.tick(grp);
+      unsigned long long done = latency::now();
+      fromqueue.record(done - block[ii].enqueued);
+      fromdue.record(done - block[ii].due);
+      rst.lap(true);
+    }
+  }
+  grp.finishOutput();
+  report(grp);
+  rst.print();
+  double secs = (latency::now() - started) * 1e-9;
+  std::cerr << "replay records " << fromqueue.getCount() << " seconds "
+    << secs << " rate " << fromqueue.getCount() / secs << " records/s"
+    << std::endl << "replay_latency_us " << fromqueue.summary(1000.0)
+    << std::endl << "replay_corrected_us " << fromdue.summary(1000.0)
+    << std::endl;
+}
+
+// Run with the engine selected on the command line, args are the
+// remaining command line arguments
+template <class Engine>
+void run(const runopts& opts, int nargs, char* args[], const char* prog) {
+  if( NULL != opts.outdir ) {
+    // Expect one or more input files or directories
+    if( nargs < 1 ) {
+      usage(prog);
+    }
+    std::vector<std::string> infiles;
+    for(int ii = 0; ii < nargs; ii++) {
+      venmofeed::listInputs(args[ii], infiles);
+    }
+    runFiles<Engine>(opts, infiles);
+  } else if( opts.merge ) {
+    // Expect one or more feeds and the output filename
+    if( nargs < 2 ) {
+      usage(prog);
+    }
+    runMerge<Engine>(opts, nargs - 1, args, args[nargs - 1]);
+  } else {
+    // Expect two command line parameters, input and output filenames
+    if( nargs != 2 ) {
+      usage(prog);
+    }
+    if( opts.speed > 0 ) {
+      runReplay<Engine>(opts, args[0], args[1]);
+    } else {
+      runSingle<Engine>(opts, args[0], args[1]);
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+
+  runopts opts;
+  std::string engine = "classic";
+  static struct option longopts[] = {
+    {"outdir", required_argument, NULL, 'o'},
+    {"stats", no_argument, NULL, 'S'},
+    {"engine", required_argument, NULL, 'e'},
+    {"directed", no_argument, NULL, 'D'},
+    {"wide", no_argument, NULL, 'W'},
+    {"emit", required_argument, NULL, 'm'},
+    {"windows", required_argument, NULL, 'w'},
+    {"spill", required_argument, NULL, 's'},
+    {"top", required_argument, NULL, 't'},
+    {"budget", required_argument, NULL, 'b'},
+    {"batch", required_argument, NULL, 'B'},
+    {"components", no_argument, NULL, 'c'},
+    {"format", required_argument, NULL, 'F'},
+    {"query", required_argument, NULL, 'Q'},
+    {"adjacency", required_argument, NULL, 'a'},
+    {"replay", required_argument, NULL, 'R'},
+    {"shards", required_argument, NULL, 'N'},
+    {"reclaim", required_argument, NULL, 'r'},
+    {"start-at", required_argument, NULL, 'T'},
+    {"merge", no_argument, NULL, 'M'},
+    {"memory", required_argument, NULL, 'L'},
+    {"amounts", required_argument, NULL, 'A'},
+    {NULL, 0, NULL, 0}
+  };
+  const char* querypath = NULL;
+  const char* adjpath = NULL;
+  int opt;
+  while( -1 != (opt = getopt_long(argc, argv, "o:Se:DWm:w:s:t:b:B:cF:Q:a:R:N:r:T:ML:A:", longopts, NULL)) ) {
+    switch( opt ) {
+      case 'o':
+        opts.outdir = optarg;
+        break;
+      case 'S':
+        opts.stats = true;
+        break;
+      case 'e':
+        engine = optarg;
+        break;
+      case 'D':
+        opts.directed = true;
+        break;
+      case 'W':
+        opts.wide = true;
+        break;
+      case 'm':
+        if( ! emitter::parseMode(optarg, opts.emitmode, opts.emitevery) ) {
+          usage(argv[0]);
+        }
+        break;
+      case 'w': {
+        char* pos = optarg;
+        do {
+          char* end;
+          unsigned long window = strtoul(pos, &end, 10);
+          if( end == pos || 0 == window || window > 86400 * 366 ) {
+            usage(argv[0]);
+          }
+          opts.windows.push_back(window);
+          pos = end;
+        } while( ',' == *pos++ );
+        break;
+      }
+      case 't': {
+        char* end;
+        opts.topk = strtoul(optarg, &end, 10);
+        if( ':' == *end ) {
+          char* pos = end + 1;
+          opts.topevery = strtoul(pos, &end, 10);
+          if( end == pos ) {
+            usage(argv[0]);
+          }
+        }
+        if( 0 == opts.topk || 0 == opts.topevery || '\0' != *end ) {
+          usage(argv[0]);
+        }
+        break;
+      }
+      case 'b': {
+        char* end;
+        opts.budget = strtoul(optarg, &end, 10);
+        if( end == optarg || '\0' != *end || opts.budget < 16 ) {
+          usage(argv[0]);
+        }
+        break;
+      }
+      case 'c':
+        opts.components = true;
+        break;
+      case 'F':
+        if( ! binwriter::parseFormat(optarg, opts.bincolumns) ) {
+          usage(argv[0]);
+        }
+        break;
+      case 'Q':
+        querypath = optarg;
+        break;
+      case 'a':
+        adjpath = optarg;
+        break;
+      case 'R':
+        if( ! venmoreplay::parsePace(optarg, opts.speed, opts.rate) ) {
+          usage(argv[0]);
+        }
+        break;
+      case 'N': {
+        char* end;
+        opts.shards = strtoul(optarg, &end, 10);
+        if( end == optarg || '\0' != *end || 0 == opts.shards
+            || opts.shards > MAXSHARDS ) {
+          usage(argv[0]);
+        }
+        break;
+      }
+      case 'r': {
+        char* end;
+        opts.reclaim = strtoul(optarg, &end, 10);
+        if( end == optarg || '\0' != *end || 0 == opts.reclaim ) {
+          usage(argv[0]);
+        }
+        break;
+      }
+      case 's':
+        if( ! SpillStore::parseSpec(optarg, opts.spilldir, opts.spillhot,
+                                    opts.spilledges) ) {
+          usage(argv[0]);
+        }
+        break;
+      case 'T': {
+        char* end;
+        opts.seek = true;
+        opts.startat = ept::epochParse(optarg);
+        if( opts.startat < 0 ) {
+          opts.startat = strtoll(optarg, &end, 10);
+          if( end == optarg || '\0' != *end || opts.startat < 0 ) {
+            usage(argv[0]);
+          }
+        }
+        break;
+      }
+      case 'M':
+        opts.merge = true;
+        break;
+      case 'A':
+        // amounts are only read by the wide parser
+        opts.wide = true;
+        if( ! AmountWindow::parseQuantiles(optarg, opts.quantiles) ) {
+          usage(argv[0]);
+        }
+        break;
+      case 'L':
+        if( ! MemoryBudget::parseSpec(optarg, opts.memlimit,
+                                      opts.memaction) ) {
+          usage(argv[0]);
+        }
+        break;
+      case 'B': {
+        char* end;
+        opts.batch = strtoul(optarg, &end, 10);
+        if( end == optarg || '\0' != *end || 0 == opts.batch
+            || opts.batch > 4096 ) {
+          usage(argv[0]);
+        }
+        break;
+      }
+      default:
+        usage(argv[0]);
+    }
+  }
+  int nargs = argc - optind;
+  char** args = argv + optind;
+
+  if( (opts.topk > 0 || opts.components || opts.reclaim > 0
+      || NULL != adjpath) &&
+      ("classic" != engine || opts.directed || ! opts.windows.empty()
+      || opts.shards > 0) ) {
+    // hubs, components, background freeing and adjacency are only in
+    // the classic engine
+    usage(argv[0]);
+  } else if( 0 != opts.bincolumns && (opts.components ||
+      "approx" == engine || ! opts.windows.empty()) ) {
+    // binary output holds one median and the window counts of one graph
+    usage(argv[0]);
+  } else if( opts.speed > 0 && (NULL != opts.outdir || opts.batch > 0) ) {
+    // replay paces a single input record by record
+    usage(argv[0]);
+  } else if( ! opts.spilldir.empty() && (opts.windows.empty()
+      || "approx" == engine || opts.shards > 0) ) {
+    // only the multi-window engine has rings of seconds to spill
+    usage(argv[0]);
+  } else if( opts.seek && (NULL != opts.outdir || opts.speed > 0
+      || opts.shards > 0) ) {
+    // seeking reads one input file, shards write all their medians
+    usage(argv[0]);
+  } else if( opts.merge && (NULL != opts.outdir || opts.speed > 0
+      || opts.seek || opts.batch > 0) ) {
+    // merged records come one at a time into a single output
+    usage(argv[0]);
+  } else if( opts.shards > 0 && ("classic" != engine || opts.topk > 0
+      || opts.components || 0 != opts.bincolumns || NULL != querypath
+      || ! opts.windows.empty() || opts.speed > 0) ) {
+    // shards only report their degree histograms, medians are written
+    // asynchronously
+    usage(argv[0]);
+  } else if( NULL != querypath && ("approx" == engine ||
+      ! opts.windows.empty()) ) {
+    // snapshots hold the statistics of a single exact graph
+    usage(argv[0]);
+  } else if( ! opts.quantiles.empty() && ("classic" != engine
+      || opts.directed || ! opts.windows.empty() || opts.shards > 0
+      || 0 != opts.bincolumns || MEM_APPROX == opts.memaction) ) {
+    // only the classic engine keeps amounts, in text output
+    usage(argv[0]);
+  } else if( opts.memlimit > 0 && ("classic" != engine || opts.directed
+      || ! opts.windows.empty() || opts.shards > 0) ) {
+    // only the classic engine counts its bytes
+    usage(argv[0]);
+  } else if( MEM_APPROX == opts.memaction && (opts.topk > 0
+      || opts.components || NULL != adjpath || 0 != opts.bincolumns) ) {
+    // the approximate engine writes plain medians and keeps no names
+    usage(argv[0]);
+  }
+
+  // stays up until all inputs are processed
+  StatsSnapshot snapshot;
+  StatsServer* server = NULL;
+  if( NULL != querypath ) {
+    opts.snapshot = &snapshot;
+    server = new StatsServer(snapshot, querypath);
+    server->start();
+  }
+  QueryBox queries;
+  QueryServer* adjserver = NULL;
+  if( NULL != adjpath ) {
+    opts.queries = &queries;
+    adjserver = new QueryServer(queries, adjpath);
+    adjserver->start();
+  }
+
+  if( opts.shards > 0 ) {
+    run<ShardedGraph>(opts, nargs, args, argv[0]);
+  } else if( "approx" == engine ) {
+    // one window only, the approximate engine has undirected edges
+    if( opts.directed || opts.windows.size() > 1 ) {
+      usage(argv[0]);
     }
+    run<ApproxGraph>(opts, nargs, args, argv[0]);
+  } else if( ! opts.windows.empty() ) {
+    // several windows always run on the multi-window engine
+    run<MultiGraph>(opts, nargs, args, argv[0]);
+  } else if( "classic" == engine && ! opts.directed ) {
+    run<Graph>(opts, nargs, args, argv[0]);
+  } else if( "static" == engine && ! opts.directed ) {
+    run< TGraph<MAXSEC, htb::hashmask1 + 1, EN, false> >(
+      opts, nargs, args, argv[0]);
+  } else if( "static" == engine ) {
+    run< TGraph<MAXSEC, htb::hashmask1 + 1, EN, true> >(
+      opts, nargs, args, argv[0]);
+  } else {
+    usage(argv[0]);
   }
+  delete adjserver;
+  delete server;
 
   return 0;
 }
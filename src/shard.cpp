@@ -0,0 +1,478 @@
+#include <string>
+#include <vector>
+#include <cassert>       // assert
+#include <cerrno>
+#include <cstring>       // memcpy
+#include <unistd.h>      // fork, read, close, _exit
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "stringutils.h"
+#include "epochtime.h"
+#include "venmodata.h"
+#include "venmoio.h"
+#include "hashtable.h"
+#include "emitter.h"
+#include "multigraph.h"
+#include "shard.h"
+
+// Bytes read from a socket at a time, and buffered before writing
+#define SHARDIO (1 << 16)
+
+
+static void put64(std::string& buf, unsigned long long value) {
+  buf.append((const char*) &value, sizeof(value));
+}
+
+static void put32(std::string& buf, unsigned int value) {
+  buf.append((const char*) &value, sizeof(value));
+}
+
+// Write all of buf to a socket, a worker that went away is fatal
+static void sendAll(int fd, std::string& buf) {
+  std::size_t done = 0;
+  while( done < buf.size() ) {
+    ssize_t count = send(fd, buf.data() + done, buf.size() - done,
+                         MSG_NOSIGNAL);
+    if( count < 0 && EINTR == errno ) {
+      continue;
+    }
+    if( count <= 0 ) {
+      stu::abortf("Lost connection to shard process\n");
+    }
+    done += count;
+  }
+  buf.clear();
+}
+
+
+void ShardLayer::setOwned(uint id, bool mine) {
+  if( id >= owned.size() ) {
+    owned.resize(store->idRange(), 0);
+  }
+  owned[id] = mine;
+}
+
+void ShardLayer::note(uint mydeg, int diff) {
+  if( mydeg >= change.size() ) {
+    change.resize((mydeg + 1) << 1, 0);
+  }
+  if( 0 == change[mydeg] ) {
+    touched.push_back(mydeg);
+  }
+  change[mydeg] += diff;
+}
+
+// Owned nodes go through the histogram, others only keep their degree
+// and their place in the store
+void ShardLayer::incDeg(uint id) {
+  if( id >= deg.size() ) {
+    deg.resize(store->idRange(), 0);
+  }
+  if( owned[id] ) {
+    uint mydeg = deg[id];
+    WindowLayer::incDeg(id);
+    if( mydeg > 0 ) {
+      note(mydeg, -1);
+    }
+    note(mydeg + 1, 1);
+  } else if( 0 == deg[id]++ ) {
+    store->liveCount(id)++;
+  }
+}
+
+void ShardLayer::decDeg(uint id) {
+  if( owned[id] ) {
+    uint mydeg = deg[id];
+    note(mydeg, -1);
+    if( mydeg > 1 ) {
+      note(mydeg - 1, 1);
+    }
+    // may release id
+    WindowLayer::decDeg(id);
+  } else if( 0 == --deg[id] && 0 == --store->liveCount(id) ) {
+    store->release(id);
+  }
+}
+
+void ShardLayer::evictAll() {
+  for(uint ii = 1; ii <= maxdeg; ii++) {
+    if( degrees[ii] > 0 ) {
+      note(ii, -(int)degrees[ii]);
+    }
+  }
+  WindowLayer::evictAll();
+}
+
+void ShardLayer::takeChanges(std::string& answer) {
+  std::size_t countpos = answer.size();
+  unsigned int count = 0;
+  put32(answer, count);
+  for(std::size_t ii = 0; ii < touched.size(); ii++) {
+    uint mydeg = touched[ii];
+    // degrees touched twice are listed twice, the second time with 0
+    if( 0 != change[mydeg] ) {
+      put32(answer, mydeg);
+      put32(answer, (unsigned int) change[mydeg]);
+      change[mydeg] = 0;
+      count++;
+    }
+  }
+  touched.clear();
+  memcpy(&answer[countpos], &count, sizeof(count));
+}
+
+
+// Make count bytes available, false at end of input. Pending answers
+// go out before waiting, the coordinator may be waiting for them.
+bool ShardWorker::need(std::size_t count) {
+  while( inbuf.size() - inpos < count ) {
+    flush();
+    if( inpos > 0 ) {
+      inbuf.erase(0, inpos);
+      inpos = 0;
+    }
+    char buf[SHARDIO];
+    ssize_t nread = read(fd, buf, sizeof(buf));
+    if( nread < 0 && EINTR == errno ) {
+      continue;
+    }
+    if( nread <= 0 ) {
+      return false;
+    }
+    inbuf.append(buf, nread);
+  }
+  return true;
+}
+
+void ShardWorker::flush() {
+  sendAll(fd, outbuf);
+}
+
+unsigned long long ShardWorker::get64() {
+  unsigned long long value;
+  memcpy(&value, inbuf.data() + inpos, sizeof(value));
+  inpos += sizeof(value);
+  return value;
+}
+
+unsigned int ShardWorker::get32() {
+  unsigned int value;
+  memcpy(&value, inbuf.data() + inpos, sizeof(value));
+  inpos += sizeof(value);
+  return value;
+}
+
+std::string ShardWorker::getName() {
+  if( ! need(4) ) {
+    stu::abortf("Truncated shard message\n");
+  }
+  unsigned int length = get32();
+  if( ! need(length) ) {
+    stu::abortf("Truncated shard message\n");
+  }
+  std::string name = inbuf.substr(inpos, length);
+  inpos += length;
+  return name;
+}
+
+void ShardWorker::run() {
+  while( need(1) ) {
+    char tag = inbuf[inpos++];
+    if( SHARD_END == tag ) {
+      break;
+    }
+    if( ! need(16) ) {
+      stu::abortf("Truncated shard message\n");
+    }
+    unsigned long long seq = get64();
+    time_t epochtime = (long long) get64();
+    if( SHARD_TICK == tag ) {
+      layer.advance(epochtime);
+    } else if( SHARD_RECORD == tag && need(1) ) {
+      char owned = inbuf[inpos++];
+      std::string actor = getName();
+      std::string target = getName();
+      uint ids[2] = {store.findOrAdd(actor), store.findOrAdd(target)};
+      layer.setOwned(ids[0], owned & 1);
+      layer.setOwned(ids[1], owned & 2);
+      // pin both nodes across evictions as MultiGraph::process does
+      store.liveCount(ids[0])++;
+      if( ids[0] != ids[1] ) {
+        store.liveCount(ids[1])++;
+      }
+      layer.process(ids[0], ids[1], epochtime);
+      if( 0 == --store.liveCount(ids[0]) ) {
+        store.release(ids[0]);
+      }
+      if( ids[0] != ids[1] && 0 == --store.liveCount(ids[1]) ) {
+        store.release(ids[1]);
+      }
+    } else {
+      stu::abortf("Bad shard message\n");
+    }
+    put64(outbuf, seq);
+    layer.takeChanges(outbuf);
+    if( outbuf.size() >= SHARDIO ) {
+      flush();
+    }
+  }
+  flush();
+}
+
+
+ShardedGraph::ShardedGraph(venmoio* vio):
+  vio(vio), nshards(0), currtime(-MAXSEC), seq(0), queue(8), synced(1),
+  degrees(2048, 0), maxdeg(1), emit(vio) {
+}
+
+ShardedGraph::~ShardedGraph() {
+  stop();
+}
+
+uint ShardedGraph::owner(const std::string& name, uint nshards) {
+  return htb::mkhash(name) % nshards;
+}
+
+void ShardedGraph::setShards(uint n) {
+  if( 0 != nshards || 0 == n || n > MAXSHARDS ) {
+    stu::abortf("Number of shards must be 1 to %d\n", MAXSHARDS);
+  }
+  for(uint shard = 0; shard < n; shard++) {
+    int pair[2];
+    if( 0 != socketpair(AF_UNIX, SOCK_STREAM, 0, pair) ) {
+      stu::abortf("Cannot create socket for shard %u\n", shard);
+    }
+    pid_t pid = fork();
+    if( pid < 0 ) {
+      stu::abortf("Cannot start shard process %u\n", shard);
+    }
+    if( 0 == pid ) {
+      // worker: keep only its own socket, leave without running any
+      // destructor of the parent's objects
+      close(pair[0]);
+      for(std::size_t ii = 0; ii < fds.size(); ii++) {
+        close(fds[ii]);
+      }
+      {
+        ShardWorker worker(pair[1]);
+        worker.run();
+      }
+      _exit(0);
+    }
+    close(pair[1]);
+    fds.push_back(pair[0]);
+    pids.push_back(pid);
+  }
+  nshards = n;
+  outbufs.resize(n);
+  inbufs.resize(n);
+  inpos.assign(n, 0);
+  coordinator = std::thread(&ShardedGraph::coordinate, this);
+}
+
+// Route a record, with the same time decisions as Graph::process
+void ShardedGraph::process(venmodata* vdt) {
+  shardstep step = {currtime, 0};
+  time_t timediff = vdt->epochtime - currtime;
+  if( timediff > -MAXSEC ) {
+    uint ends[2] = {owner(vdt->actor, nshards), owner(vdt->target, nshards)};
+    if( timediff > 0 ) {
+      // every shard evicts up to the new time
+      currtime = vdt->epochtime;
+      step.time = currtime;
+      step.mask = (nshards < 64) ? (1ULL << nshards) - 1 : ~0ULL;
+    }
+    step.mask |= (1ULL << ends[0]) | (1ULL << ends[1]);
+    for(uint shard = 0; shard < nshards; shard++) {
+      if( 0 == (step.mask & (1ULL << shard)) ) {
+        continue;
+      }
+      std::string& buf = outbufs[shard];
+      char owned = (ends[0] == shard ? 1 : 0) | (ends[1] == shard ? 2 : 0);
+      buf.push_back(owned ? SHARD_RECORD : SHARD_TICK);
+      put64(buf, seq);
+      put64(buf, (long long) vdt->epochtime);
+      if( owned ) {
+        buf.push_back(owned);
+        put32(buf, vdt->actor.length());
+        buf.append(vdt->actor);
+        put32(buf, vdt->target.length());
+        buf.append(vdt->target);
+      }
+    }
+  }
+  seq++;
+  steps.push_back(step);
+  if( steps.size() >= SHARDBLOCK ) {
+    pushSteps();
+  }
+}
+
+void ShardedGraph::output() {
+}
+
+void ShardedGraph::flushShards() {
+  for(uint shard = 0; shard < nshards; shard++) {
+    sendAll(fds[shard], outbufs[shard]);
+  }
+}
+
+// Shards get their messages before the coordinator waits for answers
+void ShardedGraph::pushSteps() {
+  flushShards();
+  if( ! steps.empty() ) {
+    queue.push(std::move(steps));
+    steps = std::vector<shardstep>();
+    steps.reserve(SHARDBLOCK);
+  }
+}
+
+// Coordinator thread body: merge answers record by record and write
+// medians, an empty block asks for a confirmation that all is written
+void ShardedGraph::coordinate() {
+  std::vector<shardstep> block;
+  unsigned long long done = 0;
+  while( queue.pop(block) ) {
+    if( block.empty() ) {
+      synced.push(0);
+      continue;
+    }
+    for(std::size_t ii = 0; ii < block.size(); ii++, done++) {
+      for(uint shard = 0; shard < nshards; shard++) {
+        if( block[ii].mask & (1ULL << shard) ) {
+          applyAnswer(shard, done);
+        }
+      }
+      while( maxdeg > 1 && 0 == degrees[maxdeg] ) {
+        maxdeg--;
+      }
+      if( emit.due(block[ii].time) ) {
+        emit.put(median2());
+      }
+    }
+  }
+}
+
+// Wait for count bytes from shard. Reads whatever every shard has sent
+// meanwhile, so that no shard blocks on a full socket while the
+// coordinator waits for another one.
+void ShardedGraph::receive(uint shard, std::size_t count) {
+  std::vector<struct pollfd> pfds(nshards);
+  while( inbufs[shard].size() - inpos[shard] < count ) {
+    for(uint ii = 0; ii < nshards; ii++) {
+      pfds[ii].fd = fds[ii];
+      pfds[ii].events = POLLIN;
+      pfds[ii].revents = 0;
+    }
+    if( poll(&pfds[0], nshards, -1) < 0 ) {
+      if( EINTR == errno ) {
+        continue;
+      }
+      stu::abortf("Cannot wait for shard processes\n");
+    }
+    for(uint ii = 0; ii < nshards; ii++) {
+      if( 0 == pfds[ii].revents ) {
+        continue;
+      }
+      if( inpos[ii] >= SHARDIO && inpos[ii] * 2 >= inbufs[ii].size() ) {
+        inbufs[ii].erase(0, inpos[ii]);
+        inpos[ii] = 0;
+      }
+      char buf[SHARDIO];
+      ssize_t nread = read(fds[ii], buf, sizeof(buf));
+      if( nread <= 0 && ! (nread < 0 && EINTR == errno) ) {
+        stu::abortf("Shard process %u exited unexpectedly\n", ii);
+      }
+      if( nread > 0 ) {
+        inbufs[ii].append(buf, nread);
+      }
+    }
+  }
+}
+
+void ShardedGraph::applyAnswer(uint shard, unsigned long long myseq) {
+  unsigned long long answerseq;
+  unsigned int count;
+  receive(shard, sizeof(answerseq) + sizeof(count));
+  const char* pos = inbufs[shard].data() + inpos[shard];
+  memcpy(&answerseq, pos, sizeof(answerseq));
+  memcpy(&count, pos + sizeof(answerseq), sizeof(count));
+  if( answerseq != myseq ) {
+    stu::abortf("Shard %u out of step at record %llu\n", shard, myseq);
+  }
+  std::size_t length = sizeof(answerseq) + sizeof(count) + 8 * count;
+  receive(shard, length);
+  pos = inbufs[shard].data() + inpos[shard] + sizeof(answerseq)
+    + sizeof(count);
+  for(unsigned int ii = 0; ii < count; ii++) {
+    unsigned int mydeg, diff;
+    memcpy(&mydeg, pos, sizeof(mydeg));
+    memcpy(&diff, pos + sizeof(mydeg), sizeof(diff));
+    pos += sizeof(mydeg) + sizeof(diff);
+    if( mydeg >= degrees.size() ) {
+      degrees.resize((mydeg + 1) << 1, 0);
+    }
+    // each shard's changes keep its own histogram, and so the sum,
+    // non-negative, unsigned wrap around adds negative changes
+    degrees[mydeg] += diff;
+    if( mydeg > maxdeg && 0 != degrees[mydeg] ) {
+      maxdeg = mydeg;
+    }
+  }
+  inpos[shard] += length;
+}
+
+// Twice the median from degree occupations, exactly as Graph::median2
+uint ShardedGraph::median2() const {
+  assert( 0 == degrees[0] );
+  uint ii;
+  unsigned long long int sum = 0;
+  for(ii = 0; ii <= maxdeg; ii++) {
+    sum += degrees[ii];
+  }
+  unsigned long long int sum2 = 0;
+  for(ii = 0; ii <= maxdeg; ii++) {
+    sum2 += 2*degrees[ii];
+    if( sum2 >= sum ) {
+      break;
+    }
+  }
+  return 2*ii + ((sum2 > sum) ? 0 : 1);
+}
+
+void ShardedGraph::setOutputMode(int mode, unsigned long every) {
+  emit.setMode(mode, every);
+}
+
+void ShardedGraph::finishOutput() {
+  if( nshards > 0 ) {
+    pushSteps();
+    queue.push(std::vector<shardstep>());
+    int token;
+    synced.pop(token);
+  }
+  emit.finish();
+}
+
+// Send end messages, wait for the coordinator and the workers
+void ShardedGraph::stop() {
+  if( 0 == nshards ) {
+    return;
+  }
+  for(uint shard = 0; shard < nshards; shard++) {
+    outbufs[shard].push_back(SHARD_END);
+  }
+  pushSteps();
+  queue.close();
+  coordinator.join();
+  for(uint shard = 0; shard < nshards; shard++) {
+    close(fds[shard]);
+    int status;
+    if( waitpid(pids[shard], &status, 0) != pids[shard]
+        || ! WIFEXITED(status) || 0 != WEXITSTATUS(status) ) {
+      stu::abortf("Shard process %u failed\n", shard);
+    }
+  }
+  nshards = 0;
+}
@@ -0,0 +1,141 @@
+#ifndef SHARD_H
+#define SHARD_H
+#include <string>
+#include <vector>
+#include <thread>
+#include <sys/types.h>   // pid_t
+#include <time.h>        // time_t
+#include "epochtime.h"
+#include "venmodata.h"
+#include "venmoio.h"
+#include "emitter.h"
+#include "blockqueue.h"
+#include "multigraph.h"
+
+// Most shard workers, a record sequence number keeps a bit mask of them
+#define MAXSHARDS 64
+
+// Sequence numbers the router hands to the coordinator at a time
+#define SHARDBLOCK 4096
+
+// Messages on the socket between the router and a shard, one per
+// record sequence number the shard takes part in:
+//   record  'R', uint64 seq, int64 time, uint8 owned, then actor and
+//           target as uint32 length and bytes. Bit 0 of owned is set
+//           if the shard owns actor, bit 1 if it owns target.
+//   tick    'T', uint64 seq, int64 time: window moves up to time
+//   end     'E': no more messages, the shard exits
+// and one answer per record or tick back to the coordinator:
+//   answer  uint64 seq, uint32 count, count times uint32 degree and
+//           int32 change of the number of owned nodes of that degree
+// All numbers in host byte order, both ends run on the same machine.
+#define SHARD_RECORD 'R'
+#define SHARD_TICK 'T'
+#define SHARD_END 'E'
+
+// Window of one shard: holds every edge routed to the shard, but its
+// degree histogram only counts the nodes the shard owns, whose degrees
+// are complete as all their edges are routed here. Other end nodes are
+// kept with their partial degree for edge bookkeeping only. Changes of
+// the histogram are collected until the shard answers for a record.
+class ShardLayer : public WindowLayer {
+protected:
+  std::vector<char> owned;
+  std::vector<int> change;
+  std::vector<uint> touched;
+  void note(uint mydeg, int diff);
+  virtual void incDeg(uint id);
+  virtual void decDeg(uint id);
+
+public:
+  ShardLayer(NameStore* store): WindowLayer(store, MAXSEC) {};
+  // Whether node id is owned by this shard, set before using the id
+  void setOwned(uint id, bool mine);
+  virtual void evictAll();
+  // Append count, degree and change entries of an answer, and forget
+  void takeChanges(std::string& answer);
+};
+
+// Body of a forked shard process: reads messages from the socket until
+// the end message, answers each with the changes it caused
+class ShardWorker {
+protected:
+  int fd;
+  NameStore store;
+  ShardLayer layer;
+  std::string inbuf, outbuf;
+  std::size_t inpos;
+  bool need(std::size_t count);
+  void flush();
+  unsigned long long get64();
+  unsigned int get32();
+  std::string getName();
+
+public:
+  ShardWorker(int fd): fd(fd), layer(&store), inpos(0) {};
+  void run();
+};
+
+// Router to shards and coordinator of their answers for one sequence
+// number, a record, each
+struct shardstep {
+  // newest time after the record, for the emitter
+  time_t time;
+  // shards that answer for this record
+  unsigned long long mask;
+};
+
+// Engine spreading the 60 second graph over worker processes. Each node
+// has an owner shard by hash of its name, and each edge is sent to the
+// owners of both its end nodes, so every shard knows the exact degree
+// of the nodes it owns. The router, process, keeps the newest time as
+// Graph does, drops records too old for the window and tells every
+// shard when the window moves, so that all shards evict in step. A
+// coordinator thread adds the histogram changes of all shards for one
+// record after the other to the histogram of the whole graph, which is
+// then exactly Graph's, and writes the medians. Workers are forked by
+// setShards, talk over UNIX domain socket pairs and exit with the engine.
+class ShardedGraph {
+protected:
+  venmoio* vio;
+  uint nshards;
+  std::vector<int> fds;
+  std::vector<pid_t> pids;
+  // router side
+  time_t currtime;
+  unsigned long long seq;
+  std::vector<std::string> outbufs;
+  std::vector<shardstep> steps;
+  BlockQueue< std::vector<shardstep> > queue;
+  BlockQueue<int> synced;
+  std::thread coordinator;
+  // coordinator side
+  std::vector<std::string> inbufs;
+  std::vector<std::size_t> inpos;
+  std::vector<uint> degrees;
+  uint maxdeg;
+  emitter emit;
+
+  static uint owner(const std::string& name, uint nshards);
+  void flushShards();
+  void pushSteps();
+  void coordinate();
+  void receive(uint shard, std::size_t count);
+  void applyAnswer(uint shard, unsigned long long myseq);
+  uint median2() const;
+  void stop();
+
+public:
+  ShardedGraph(venmoio* vio);
+  ~ShardedGraph();
+  // Fork n worker processes, call once before processing
+  void setShards(uint n);
+  void process(venmodata* vdt);
+  // Medians are written by the coordinator
+  void output();
+  void setOutputMode(int mode, unsigned long every = 1);
+  // Wait until every routed record has its median written
+  void finishOutput();
+};
+
+#endif
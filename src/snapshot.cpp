@@ -0,0 +1,129 @@
+#include <string>
+#include <cstring>       // strncpy
+#include <cstdio>        // snprintf
+#include <unistd.h>      // close, unlink, write
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "snapshot.h"
+#include "stringutils.h"
+
+// Milliseconds the server waits for a connection before it checks
+// whether it should stop
+#define SERVERPOLL 200
+
+
+void StatsSnapshot::publish(unsigned int mymedian2, unsigned int mynodes,
+    unsigned int myedges, unsigned int mymaxdeg, long long mytime,
+    unsigned long long mybytes) {
+  unsigned long long start = seq.load(std::memory_order_relaxed);
+  seq.store(start + 1, std::memory_order_relaxed);
+  // odd sequence becomes visible before any of the new values
+  std::atomic_thread_fence(std::memory_order_release);
+  records.store(++published, std::memory_order_relaxed);
+  time.store(mytime, std::memory_order_relaxed);
+  median2.store(mymedian2, std::memory_order_relaxed);
+  nodes.store(mynodes, std::memory_order_relaxed);
+  edges.store(myedges, std::memory_order_relaxed);
+  maxdeg.store(mymaxdeg, std::memory_order_relaxed);
+  bytes.store(mybytes, std::memory_order_relaxed);
+  seq.store(start + 2, std::memory_order_release);
+}
+
+void StatsSnapshot::read(graphstats& stats) const {
+  unsigned long long before, after;
+  do {
+    before = seq.load(std::memory_order_acquire);
+    if( before & 1 ) {
+      // writer busy, it never waits, so this ends within a few stores
+      after = before + 1;
+      continue;
+    }
+    stats.records = records.load(std::memory_order_relaxed);
+    stats.time = time.load(std::memory_order_relaxed);
+    stats.median2 = median2.load(std::memory_order_relaxed);
+    stats.nodes = nodes.load(std::memory_order_relaxed);
+    stats.edges = edges.load(std::memory_order_relaxed);
+    stats.maxdeg = maxdeg.load(std::memory_order_relaxed);
+    stats.bytes = bytes.load(std::memory_order_relaxed);
+    // values are read before the sequence is checked again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = seq.load(std::memory_order_relaxed);
+  } while( before != after );
+}
+
+
+StatsServer::~StatsServer() {
+  stopping = true;
+  if( server.joinable() ) {
+    server.join();
+  }
+  if( fd >= 0 ) {
+    close(fd);
+    unlink(path.c_str());
+  }
+}
+
+void StatsServer::start() {
+  fd = listenLocal(path);
+  server = std::thread(&StatsServer::serve, this);
+}
+
+int StatsServer::listenLocal(const std::string& path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if( path.empty() || path.length() >= sizeof(addr.sun_path) ) {
+    stu::abortf("Query socket path must have 1 to %d characters: %s\n",
+      (int) sizeof(addr.sun_path) - 1, path.c_str());
+  }
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  int myfd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if( myfd < 0 ) {
+    stu::abortf("Cannot create query socket\n");
+  }
+  // a socket left behind by an earlier run would make bind fail
+  unlink(path.c_str());
+  if( 0 != bind(myfd, (struct sockaddr*) &addr, sizeof(addr))
+      || 0 != listen(myfd, 16) ) {
+    stu::abortf("Cannot listen on query socket %s\n", path.c_str());
+  }
+  return myfd;
+}
+
+// Server thread body: one line per connection, then hang up
+void StatsServer::serve() {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  while( ! stopping ) {
+    if( poll(&pfd, 1, SERVERPOLL) <= 0 ) {
+      continue;
+    }
+    int client = accept(fd, NULL, NULL);
+    if( client < 0 ) {
+      continue;
+    }
+    graphstats stats;
+    snapshot.read(stats);
+    std::string line = format(stats);
+    // a client that went away costs nothing but the failed write
+    ssize_t written = send(client, line.data(), line.length(), MSG_NOSIGNAL);
+    (void) written;
+    close(client);
+  }
+}
+
+std::string StatsServer::format(const graphstats& stats) {
+  char buf[192];
+  int len = snprintf(buf, sizeof(buf),
+    "records %llu median %u.%s nodes %u edges %u maxdeg %u time %lld",
+    stats.records, stats.median2 / 2, (stats.median2 & 1) ? "50" : "00",
+    stats.nodes, stats.edges, stats.maxdeg, stats.time);
+  if( 0 != stats.bytes ) {
+    len += snprintf(buf + len, sizeof(buf) - len, " bytes %llu",
+      stats.bytes);
+  }
+  snprintf(buf + len, sizeof(buf) - len, "\n");
+  return buf;
+}
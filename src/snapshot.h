@@ -0,0 +1,75 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <string>
+#include <atomic>
+#include <thread>
+
+// Statistics of the window graph after one record
+struct graphstats {
+  // records published so far
+  unsigned long long records;
+  // epoch time of newest record
+  long long time;
+  unsigned int median2, nodes, edges, maxdeg;
+  // bytes held by the window as of the latest count, 0 if not counted
+  unsigned long long bytes;
+  graphstats(): records(0), time(0), median2(0), nodes(0), edges(0),
+    maxdeg(0), bytes(0) {};
+};
+
+// Latest graph statistics, written by the graph thread and readable by
+// any number of other threads without locks, as a sequence lock: the
+// writer makes the sequence odd, stores the fields and makes it even
+// again, a reader retries while the sequence is odd or changed during
+// its read. The writer never waits, so polling readers cost ingestion
+// no more than the cache line transfers of the values they read.
+// Fields are relaxed atomics, so torn reads are detected, not undefined.
+class StatsSnapshot {
+protected:
+  // own cache line, away from whatever the writer touches next to it
+  alignas(64) std::atomic<unsigned long long> seq;
+  std::atomic<unsigned long long> records;
+  std::atomic<long long> time;
+  std::atomic<unsigned int> median2, nodes, edges, maxdeg;
+  std::atomic<unsigned long long> bytes;
+  // writer side count, only touched by the graph thread
+  unsigned long long published;
+
+public:
+  StatsSnapshot(): seq(0), records(0), time(0), median2(0), nodes(0),
+    edges(0), maxdeg(0), bytes(0), published(0) {};
+  // Graph thread only, counts one record per call
+  void publish(unsigned int mymedian2, unsigned int mynodes,
+               unsigned int myedges, unsigned int mymaxdeg, long long mytime,
+               unsigned long long mybytes = 0);
+  // Consistent copy of the latest statistics, any thread
+  void read(graphstats& stats) const;
+};
+
+// Answers each connection to a local UNIX domain socket with one line of
+// the latest statistics, e.g. from a shell: nc -U <path>
+//   records 1234 median 1.50 nodes 310 edges 242 maxdeg 6 time 1460149697
+// followed by " bytes N" for engines that count the bytes they hold
+// Runs on its own thread until destroyed, which also removes the socket.
+class StatsServer {
+protected:
+  const StatsSnapshot& snapshot;
+  std::string path;
+  int fd;
+  std::atomic<bool> stopping;
+  std::thread server;
+  void serve();
+
+public:
+  StatsServer(const StatsSnapshot& snapshot, const std::string& path):
+    snapshot(snapshot), path(path), fd(-1), stopping(false) {};
+  ~StatsServer();
+  // Bind the socket, replacing a stale one, and start answering
+  void start();
+
+  static std::string format(const graphstats& stats);
+  // Listening UNIX domain socket at path, replacing a stale one
+  static int listenLocal(const std::string& path);
+};
+
+#endif
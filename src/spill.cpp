@@ -0,0 +1,170 @@
+#include <string>
+#include <vector>
+#include <cstdlib>       // mkstemp strtoull
+#include <climits>       // UINT_MAX
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>      // write close unlink sysconf
+#include <sys/mman.h>
+#include <sys/stat.h>    // mkdir
+#include "stringutils.h"
+#include "spill.h"
+
+
+SpillStore::SpillStore(const std::string& dir, std::size_t segsize):
+  dir(dir), current(0), segsize(segsize), written(0), ondisk(0), peak(0) {
+  // a single directory level, as for output directories
+  mkdir(dir.c_str(), 0755);
+  current = openSegment();
+}
+
+SpillStore::~SpillStore() {
+  for(unsigned int id = 0; id < segments.size(); id++) {
+    if( segments[id].fd >= 0 ) {
+      closeSegment(id);
+    }
+  }
+}
+
+// New empty segment file, already unlinked
+unsigned int SpillStore::openSegment() {
+  std::string path = dir + "/spillXXXXXX";
+  std::vector<char> name(path.begin(), path.end());
+  name.push_back('\0');
+  int fd = mkstemp(&name[0]);
+  if( fd < 0 ) {
+    stu::abortf("Cannot create spill segment in %s\n", dir.c_str());
+  }
+  unlink(&name[0]);
+  segment seg = {fd, 0, 0, NULL, 0};
+  if( freeslots.empty() ) {
+    segments.push_back(seg);
+    return segments.size() - 1;
+  }
+  unsigned int id = freeslots.back();
+  freeslots.pop_back();
+  segments[id] = seg;
+  return id;
+}
+
+void SpillStore::closeSegment(unsigned int id) {
+  if( NULL != segments[id].base ) {
+    munmap((void*) segments[id].base, segments[id].maplen);
+    segments[id].base = NULL;
+  }
+  close(segments[id].fd);
+  ondisk -= segments[id].size;
+  segments[id].fd = -1;
+  segments[id].size = 0;
+  freeslots.push_back(id);
+}
+
+spillextent SpillStore::write(const unsigned long long* keys,
+                              std::size_t count, time_t time) {
+  std::size_t bytes = count * sizeof(unsigned long long);
+  segment* seg = &segments[current];
+  if( seg->size > 0 && seg->size + bytes > segsize ) {
+    // full, the old one goes once all its extents are released
+    unsigned int old = current;
+    current = openSegment();
+    if( 0 == segments[old].live ) {
+      closeSegment(old);
+    }
+    seg = &segments[current];
+  }
+  spillextent ext = {current, time, seg->size, count};
+  const char* data = (const char*) keys;
+  std::size_t done = 0;
+  while( done < bytes ) {
+    ssize_t res = ::write(seg->fd, data + done, bytes - done);
+    if( res < 0 && EINTR != errno ) {
+      stu::abortf("Cannot write spill segment in %s\n", dir.c_str());
+    }
+    if( res > 0 ) {
+      done += res;
+    }
+  }
+  seg->size += bytes;
+  seg->live++;
+  written += bytes;
+  ondisk += bytes;
+  if( ondisk > peak ) {
+    peak = ondisk;
+  }
+  return ext;
+}
+
+void SpillStore::release(const spillextent& ext) {
+  segment& seg = segments[ext.segment];
+  if( 0 == --seg.live && ext.segment != current ) {
+    closeSegment(ext.segment);
+  }
+}
+
+// Map a whole segment, at least segsize bytes, so that the current
+// segment needs a new mapping only when an extent goes past its end
+const unsigned long long* SpillStore::map(const spillextent& ext) {
+  segment& seg = segments[ext.segment];
+  std::size_t end = ext.offset + ext.count * sizeof(unsigned long long);
+  if( end > seg.maplen ) {
+    if( NULL != seg.base ) {
+      munmap((void*) seg.base, seg.maplen);
+    }
+    std::size_t len = (end > segsize) ? end : segsize;
+    void* addr = mmap(NULL, len, PROT_READ, MAP_SHARED, seg.fd, 0);
+    if( MAP_FAILED == addr ) {
+      stu::abortf("Cannot map spill segment in %s\n", dir.c_str());
+    }
+    madvise(addr, len, MADV_SEQUENTIAL);
+    seg.base = (const char*) addr;
+    seg.maplen = len;
+  }
+  return (const unsigned long long*) (seg.base + ext.offset);
+}
+
+// Only pages entirely inside the extent, neighbors may still be read.
+// They stay in the page cache, so this only keeps the resident size of
+// the process down.
+void SpillStore::unmapped(const spillextent& ext) {
+  std::size_t page = sysconf(_SC_PAGESIZE);
+  std::size_t start = (ext.offset + page - 1) & ~(page - 1);
+  std::size_t end = (ext.offset + ext.count * sizeof(unsigned long long))
+    & ~(page - 1);
+  if( end > start ) {
+    madvise((void*) (segments[ext.segment].base + start), end - start,
+      MADV_DONTNEED);
+  }
+}
+
+bool SpillStore::parseSpec(const char* spec, std::string& mydir,
+                           unsigned int& myhot, std::size_t& myedges) {
+  mydir = spec;
+  // numbers after the last one or two colons, the directory may hold
+  // colons itself
+  std::vector<unsigned long long> numbers;
+  std::size_t colon;
+  while( numbers.size() < 2
+         && std::string::npos != (colon = mydir.rfind(':')) ) {
+    const char* number = mydir.c_str() + colon + 1;
+    char* end;
+    unsigned long long value = strtoull(number, &end, 10);
+    if( end == number || '\0' != *end ) {
+      break;
+    }
+    numbers.insert(numbers.begin(), value);
+    mydir.erase(colon);
+  }
+  if( numbers.empty() && std::string::npos != mydir.rfind(':') ) {
+    return false;
+  }
+  if( numbers.size() > 0 ) {
+    if( 0 == numbers[0] || numbers[0] > UINT_MAX ) {
+      return false;
+    }
+    myhot = numbers[0];
+  }
+  if( numbers.size() > 1 ) {
+    myedges = numbers[1];
+  }
+  return ! mydir.empty();
+}
@@ -0,0 +1,84 @@
+#ifndef SPILL_H
+#define SPILL_H
+#include <string>
+#include <vector>
+#include <time.h>        // time_t
+
+// Bytes a segment grows to before the next one is started
+#define SPILLSEGMENT (64UL << 20)
+
+// Keys of one ring slot written out at a time, all of the same second
+struct spillextent {
+  unsigned int segment;
+  time_t time;
+  std::size_t offset, count;
+};
+
+// Append only segment files holding edge keys of cold window seconds,
+// 8 bytes per key. Keys are written in one sequential write per slot
+// and read back once, streaming over the extent in the segment's read
+// only mapping, when the second leaves the window. Each segment is
+// mapped once, so reading costs no system call. Segment files are
+// unlinked as soon as they are created, so their space goes back to
+// the file system when the last extent in a full segment is released,
+// or when the process exits.
+class SpillStore {
+protected:
+  struct segment {
+    int fd;
+    std::size_t size;
+    // extents not released yet
+    std::size_t live;
+    // mapping of the first maplen bytes, NULL until first read
+    const char* base;
+    std::size_t maplen;
+  };
+  std::string dir;
+  std::vector<segment> segments;
+  std::vector<unsigned int> freeslots;
+  unsigned int current;
+  std::size_t segsize;
+  // totals for reporting
+  unsigned long long written, ondisk, peak;
+  unsigned int openSegment();
+  void closeSegment(unsigned int id);
+
+public:
+  SpillStore(const std::string& dir, std::size_t segsize = SPILLSEGMENT);
+  ~SpillStore();
+  // Append count keys of second time, returns where they went
+  spillextent write(const unsigned long long* keys, std::size_t count,
+                    time_t time);
+  // Map extent and pass its keys to sink, which is called as
+  // sink.evictKey(key, time), then release the extent
+  template <class Sink>
+  void stream(const spillextent& ext, Sink& sink);
+  // Forget extent without reading it
+  void release(const spillextent& ext);
+  // Bytes spilled in total, and most bytes on disk at a time
+  unsigned long long bytesWritten() const { return written; }
+  unsigned long long bytesPeak() const { return peak; }
+
+  // Parse "dir", "dir:hot" with hot seconds kept in memory, or
+  // "dir:hot:edges" with at most edges live edges per window, 0 for
+  // no limit
+  static bool parseSpec(const char* spec, std::string& mydir,
+                        unsigned int& myhot, std::size_t& myedges);
+
+protected:
+  const unsigned long long* map(const spillextent& ext);
+  // Drop the pages of a streamed extent from this process
+  void unmapped(const spillextent& ext);
+};
+
+template <class Sink>
+void SpillStore::stream(const spillextent& ext, Sink& sink) {
+  const unsigned long long* keys = map(ext);
+  for(std::size_t ii = 0; ii < ext.count; ii++) {
+    sink.evictKey(keys[ii], ext.time);
+  }
+  unmapped(ext);
+  release(ext);
+}
+
+#endif
@@ -0,0 +1,49 @@
+#include <string>
+#include <cstdio>       // snprintf
+#include <time.h>
+#include "streamgen.h"
+
+
+// Hubs are users 0 .. nhubs-1, everybody else is equally likely
+unsigned int streamgen::pickUser() {
+  if( hubthresh > 0 && rng() < hubthresh ) {
+    return rng() % spec.nhubs;
+  }
+  return rng() % spec.nusers;
+}
+
+std::string streamgen::userName(unsigned int index) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "User-%07u", index);
+  return buf;
+}
+
+std::string streamgen::timeString(time_t epochtime) {
+  struct tm tmbuf;
+  char buf[32];
+  gmtime_r(&epochtime, &tmbuf);
+  strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tmbuf);
+  return buf;
+}
+
+bool streamgen::next(std::string& line) {
+  if( count >= spec.nrec ) {
+    return false;
+  }
+  count++;
+  // gaps uniform in [0, 2/rate] seconds, i.e. on average rate per second
+  clock += rng() % (maxgap + 1);
+  time_t mytime = (time_t)(clock / 1000000ULL);
+  if( spec.disorder > 0 ) {
+    mytime -= rng() % (spec.disorder + 1);
+  }
+  unsigned int actor = pickUser();
+  unsigned int target = rng() % spec.nusers;
+  if( target == actor ) {
+    target = (target + 1) % spec.nusers;
+  }
+  line = "{\"created_time\": \"" + timeString(mytime)
+    + "\", \"target\": \"" + userName(target)
+    + "\", \"actor\": \"" + userName(actor) + "\"}";
+  return true;
+}
@@ -0,0 +1,49 @@
+#ifndef STREAMGEN_H
+#define STREAMGEN_H
+#include <string>
+#include <random>
+#include <time.h>       // time_t
+
+// Parameters of a generated transaction stream
+struct streamspec {
+  unsigned long nrec;      // number of records
+  unsigned int nusers;     // distinct user names
+  double rate;             // mean records per second
+  unsigned int disorder;   // max seconds a record lags behind the clock
+  double hubfrac;          // fraction of records with a hub as actor
+  unsigned int nhubs;      // number of hub users among nusers
+  unsigned int seed;
+  time_t start;            // epoch time of first record
+  streamspec(): nrec(100000), nusers(10000), rate(50.0), disorder(0),
+    hubfrac(0.0), nhubs(10), seed(1), start(1460000000) {};
+};
+
+// Deterministic generator of venmo-style Json lines. Uses only integer
+// arithmetic on the raw output of std::mt19937, which the standard pins
+// down exactly, so that a given spec yields the same stream on every
+// platform; benchmark baselines store checksums of the medians computed
+// from these streams.
+class streamgen {
+protected:
+  streamspec spec;
+  std::mt19937 rng;
+  unsigned long count;
+  // clock and maximum gap between records in microseconds
+  unsigned long long clock, maxgap;
+  // rng() below hubthresh picks a hub
+  unsigned long long hubthresh;
+  unsigned int pickUser();
+
+public:
+  streamgen(const streamspec& spec):
+    spec(spec), rng(spec.seed), count(0),
+    clock(spec.start * 1000000ULL),
+    maxgap((unsigned long long)(2000000.0 / spec.rate)),
+    hubthresh((unsigned long long)(spec.hubfrac * 4294967296.0)) {};
+  // Produce next line without newline, returns false when done
+  bool next(std::string& line);
+  static std::string userName(unsigned int index);
+  static std::string timeString(time_t epochtime);
+};
+
+#endif
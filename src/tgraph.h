@@ -0,0 +1,409 @@
+#ifndef TGRAPH_H
+#define TGRAPH_H
+#include <string>
+#include <cassert>       // assert
+#include <climits>       // UINT_MAX
+#include "epochtime.h"
+#include "venmodata.h"
+#include "venmoio.h"
+#include "stringutils.h"
+#include "emitter.h"
+#include "snapshot.h"
+#include "hashtable.h"
+
+// Compile-time specialized version of the Graph engine in graph.h.
+// Window length in seconds, node hash table size, nodes per edge and
+// directedness are template parameters rather than the MAXSEC and EN
+// macros and htb::hashmask globals, and nothing is virtual, so the
+// compiler can unroll the per second loops and inline every call.
+// Follows Graph step by step and produces identical output for
+// TGraph<MAXSEC, htb::hashmask1 + 1, 2, false>. Templates have to live
+// in headers, hence everything is defined here.
+//
+// Directed engines distinguish (actor, target) from (target, actor),
+// so they need a venmoio with setSymmetric(false), which stops the
+// parser from ordering actor and target.
+//
+// Names are hashed with SipHash under the process key of hashtable, so
+// input cannot pick colliding names. The node table starts at Buckets
+// and doubles when it holds more than TNODELOAD nodes per bucket, so
+// its chains stay short however many nodes the window holds. Edge
+// tables keep Buckets / 8 buckets per second, their chains grow with
+// the distinct edges of one second.
+// Nodes per node table bucket before the table doubles
+#define TNODELOAD 2
+
+template <unsigned int Window, unsigned int Buckets,
+          unsigned int Arity = 2, bool Directed = false>
+class TGraph {
+protected:
+  static_assert(Window > 0, "window must hold at least one second");
+  static_assert(Buckets >= 8 && 0 == (Buckets & (Buckets - 1)),
+    "bucket count must be a power of two of at least 8");
+  static_assert(Arity >= 2, "edges connect at least two nodes");
+
+  // Hash mask of edge tables, one eighth of the initial node table as
+  // in hashtable
+  static const unsigned int edgemask = (Buckets >> 3) - 1;
+
+  struct TNode {
+    std::string str;
+    unsigned long long hash;
+    unsigned int deg;
+    TNode* next;
+    TNode(const std::string& str, unsigned long long hash, TNode* next):
+      str(str), hash(hash), deg(1), next(next) {};
+  };
+
+  struct TEdge {
+    TNode* nodes[Arity];
+    TEdge* next;
+  };
+
+  venmoio* vio;
+  time_t currtime;
+  unsigned int currsec, edgenum, maxdeg, degsize;
+  unsigned int* degrees;
+  // one table of edge chains per second, allocated when first used
+  TEdge** etab[Window];
+  TNode** ntab;
+  // node table size - 1, and nodes in it
+  std::size_t nodemask, nodenum;
+  emitter emit;
+  // published after every record if set, not owned
+  StatsSnapshot* snapshot;
+
+  static unsigned long long nameHash(const std::string& str) {
+    return htb::siphash(str.data(), str.length());
+  }
+
+  // Edge hash folded from the keyed hashes of its nodes in order
+  static unsigned int edgeHash(const unsigned long long* hashes) {
+    unsigned long long hash = 0;
+    for(unsigned int ii = 0; ii < Arity; ii++) {
+      hash = (hash ^ hashes[ii]) * 0x9E3779B97F4A7C15ULL;
+    }
+    return (hash >> 32) & edgemask;
+  }
+
+  static bool sameNodes(const TEdge* edge, const std::string* names) {
+    for(unsigned int ii = 0; ii < Arity; ii++) {
+      if( edge->nodes[ii]->str != names[ii] ) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void incMaxdeg() {
+    maxdeg++;
+    // same doubling strategy as Graph::incMaxdeg
+    if( maxdeg + 1 >= degsize ) {
+      if( maxdeg >= (UINT_MAX >> 1) ) {
+        stu::abortf("Detected extremely high node degree, aborting.\n");
+      }
+      unsigned int newdegsize = degsize << 1;
+      unsigned int* temp = new unsigned int[newdegsize]();
+      for(unsigned int ii = 0; ii <= maxdeg; ii++) {
+        temp[ii] = degrees[ii];
+      }
+      delete [] degrees;
+      degrees = temp;
+      degsize = newdegsize;
+    }
+  }
+
+  // Unlink node from its chain and free it, node must exist
+  void evictExistingNode(TNode* node) {
+    TNode** link = &ntab[node->hash & nodemask];
+    while( *link != node ) {
+      assert( NULL != *link );
+      link = &(*link)->next;
+    }
+    *link = node->next;
+    nodenum--;
+    delete node;
+  }
+
+  // Double the node table, rehashing chains by their stored hashes
+  void growNodes() {
+    std::size_t newmask = (nodemask << 1) | 1;
+    TNode** newtab = new TNode*[newmask + 1]();
+    for(std::size_t hash = 0; hash <= nodemask; hash++) {
+      TNode* node = ntab[hash];
+      while( NULL != node ) {
+        TNode* next = node->next;
+        node->next = newtab[node->hash & newmask];
+        newtab[node->hash & newmask] = node;
+        node = next;
+      }
+    }
+    delete [] ntab;
+    ntab = newtab;
+    nodemask = newmask;
+  }
+
+  void reduceEdgeNodes(TEdge* edge) {
+    for(unsigned int ii = 0; ii < Arity; ii++) {
+      TNode* node = edge->nodes[ii];
+      unsigned int mydeg = node->deg;
+      degrees[mydeg]--;
+      // never below 1, as Graph::decMaxdeg
+      if( mydeg == maxdeg && mydeg > 1 && 0 == degrees[mydeg] ) {
+        maxdeg--;
+      }
+      node->deg--;
+      if( 0 == node->deg ) {
+        evictExistingNode(node);
+      } else {
+        degrees[node->deg]++;
+      }
+    }
+  }
+
+  // Remove edge with these names from whichever second holds it
+  void evictEdge(const std::string* names, unsigned int ehash) {
+    for(unsigned int mysec = 0; mysec < Window; mysec++) {
+      if( NULL == etab[mysec] ) {
+        continue;
+      }
+      TEdge** link = &etab[mysec][ehash];
+      while( NULL != *link ) {
+        if( sameNodes(*link, names) ) {
+          TEdge* edge = *link;
+          *link = edge->next;
+          edgenum--;
+          reduceEdgeNodes(edge);
+          delete edge;
+          // At most one match in database
+          return;
+        }
+        link = &(*link)->next;
+      }
+    }
+  }
+
+  void evictSectab(unsigned int sec) {
+    TEdge** sectab = etab[sec];
+    if( NULL == sectab ) {
+      return;
+    }
+    for(unsigned int hash = 0; hash <= edgemask; hash++) {
+      TEdge* edge = sectab[hash];
+      while( NULL != edge ) {
+        TEdge* next = edge->next;
+        edgenum--;
+        reduceEdgeNodes(edge);
+        delete edge;
+        edge = next;
+      }
+    }
+    delete [] sectab;
+    etab[sec] = NULL;
+  }
+
+  // Find or create node, keeping degree occupations up to date
+  TNode* touchNode(const std::string& name, unsigned long long hash) {
+    TNode** head = &ntab[hash & nodemask];
+    for(TNode* node = *head; NULL != node; node = node->next) {
+      if( node->str == name ) {
+        degrees[node->deg]--;
+        node->deg++;
+        degrees[node->deg]++;
+        if( node->deg > maxdeg ) {
+          incMaxdeg();
+        }
+        return node;
+      }
+    }
+    TNode* node = new TNode(name, hash, *head);
+    *head = node;
+    degrees[1]++;
+    if( ++nodenum > TNODELOAD * (nodemask + 1) ) {
+      growNodes();
+    }
+    return node;
+  }
+
+  void insertEdge(const std::string* names, unsigned int sec) {
+    unsigned long long hashes[Arity];
+    for(unsigned int ii = 0; ii < Arity; ii++) {
+      hashes[ii] = nameHash(names[ii]);
+    }
+    unsigned int ehash = edgeHash(hashes);
+    evictEdge(names, ehash);
+
+    TEdge* edge = new TEdge;
+    for(unsigned int ii = 0; ii < Arity; ii++) {
+      edge->nodes[ii] = touchNode(names[ii], hashes[ii]);
+    }
+    if( NULL == etab[sec] ) {
+      etab[sec] = new TEdge*[edgemask + 1]();
+    }
+    edge->next = etab[sec][ehash];
+    etab[sec][ehash] = edge;
+    edgenum++;
+  }
+
+public:
+  TGraph(venmoio* vio): vio(vio), currtime(-(time_t)Window), currsec(-1),
+    edgenum(0), maxdeg(1), degsize(2048), nodemask(Buckets - 1),
+    nodenum(0), emit(vio), snapshot(NULL) {
+    degrees = new unsigned int[degsize]();
+    ntab = new TNode*[Buckets]();
+    for(unsigned int sec = 0; sec < Window; sec++) {
+      etab[sec] = NULL;
+    }
+  };
+
+  ~TGraph() {
+    evictAll();
+    delete [] degrees;
+    delete [] ntab;
+  };
+
+  void evictAll() {
+    for(std::size_t hash = 0; hash <= nodemask; hash++) {
+      TNode* node = ntab[hash];
+      while( NULL != node ) {
+        TNode* next = node->next;
+        delete node;
+        node = next;
+      }
+      ntab[hash] = NULL;
+    }
+    for(unsigned int sec = 0; sec < Window; sec++) {
+      if( NULL != etab[sec] ) {
+        for(unsigned int hash = 0; hash <= edgemask; hash++) {
+          TEdge* edge = etab[sec][hash];
+          while( NULL != edge ) {
+            TEdge* next = edge->next;
+            delete edge;
+            edge = next;
+          }
+        }
+        delete [] etab[sec];
+        etab[sec] = NULL;
+      }
+    }
+    edgenum = 0;
+    nodenum = 0;
+    for(unsigned int deg = 0; deg <= maxdeg; deg++) {
+      degrees[deg] = 0;
+    }
+    maxdeg = 1;
+  }
+
+  // Same time handling as Graph::process, for names of Arity nodes
+  void process(const std::string* innames, time_t epochtime,
+               unsigned int sec) {
+    time_t timediff = epochtime - currtime;
+    if( timediff <= -(time_t)Window ) {
+      return;
+    }
+    if( timediff > 0 ) {
+      if( timediff >= (time_t)Window ) {
+        evictAll();
+      } else {
+        unsigned int newsec = sec;
+        if( currsec > newsec ) {
+          newsec += Window;
+        }
+        for(unsigned int index = currsec + 1; index <= newsec; index++) {
+          evictSectab(index % Window);
+        }
+      }
+      currtime = epochtime;
+      currsec = sec;
+    }
+    if( Directed ) {
+      insertEdge(innames, sec);
+    } else {
+      // order names so that permutations of the nodes are one edge
+      std::string names[Arity];
+      for(unsigned int ii = 0; ii < Arity; ii++) {
+        names[ii] = innames[ii];
+      }
+      for(unsigned int ii = 1; ii < Arity; ii++) {
+        for(unsigned int jj = ii; jj > 0 && names[jj] < names[jj - 1]; jj--) {
+          names[jj].swap(names[jj - 1]);
+        }
+      }
+      insertEdge(names, sec);
+    }
+  }
+
+  // Two node records straight from the parser
+  void process(venmodata* vdt) {
+    static_assert(2 == Arity, "venmodata records carry two nodes");
+    const std::string names[2] = {vdt->actor, vdt->target};
+    // seconds after the minute come with the record, otherwise
+    // seconds into the window are derived from epoch time
+    unsigned int sec = (MAXSEC == Window) ? vdt->sec
+      : (unsigned int)(vdt->epochtime % Window);
+    process(names, vdt->epochtime, sec);
+  }
+
+  // Twice the median from degree occupations, exactly as Graph::median2
+  unsigned int median2() const {
+    assert( 0 == degrees[0] );
+    unsigned int ii;
+    unsigned long long int sum = 0;
+    for(ii = 0; ii <= maxdeg; ii++) {
+      sum += degrees[ii];
+    }
+    unsigned long long int sum2 = 0;
+    for(ii = 0; ii <= maxdeg; ii++) {
+      sum2 += 2*degrees[ii];
+      if( sum2 >= sum ) {
+        break;
+      }
+    }
+    return 2*ii + ((sum2 > sum) ? 0 : 1);
+  }
+
+  unsigned int nodeCount() const {
+    unsigned int count = 0;
+    for(unsigned int ii = 1; ii <= maxdeg; ii++) {
+      count += degrees[ii];
+    }
+    return count;
+  }
+
+  void output() {
+    bool due = emit.due(currtime);
+    if( ! due && NULL == snapshot ) {
+      return;
+    }
+    unsigned int med2 = median2();
+    if( NULL != snapshot ) {
+      snapshot->publish(med2, nodeCount(), edgenum, maxdeg, currtime);
+    }
+    if( due ) {
+      if( emit.binary() ) {
+        emit.putRow(med2, edgenum, nodeCount(), currtime);
+      } else {
+        emit.put(med2);
+      }
+    }
+  }
+
+  void publishStats(StatsSnapshot* mysnapshot) {
+    snapshot = mysnapshot;
+  }
+
+  void setOutputMode(int mode, unsigned long every = 1) {
+    emit.setMode(mode, every);
+  }
+
+  // Binary output with column mask of binout.h, 0 for text
+  void setOutputFormat(unsigned int columns) {
+    emit.setBinary(columns);
+  }
+
+  void finishOutput() {
+    emit.finish();
+  }
+};
+
+#endif
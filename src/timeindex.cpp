@@ -0,0 +1,205 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>     // std::search
+#include <climits>       // LLONG_MIN
+#include <cstring>       // memchr
+#include <fcntl.h>       // open
+#include <unistd.h>      // close
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "epochtime.h"
+#include "stringutils.h"
+#include "timeindex.h"
+
+// Read only mapping of a whole file, unmapped when it goes out of scope
+class mappedfile {
+public:
+  const char* data;
+  long long size;
+  mappedfile(): data(NULL), size(0) {};
+  ~mappedfile() {
+    if( NULL != data ) {
+      munmap((void*) data, size);
+    }
+  }
+  // False if the file cannot be read, an empty file maps to no data
+  bool open(const std::string& fname, bool sequential) {
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if( fd < 0 ) {
+      return false;
+    }
+    struct stat st;
+    if( 0 != fstat(fd, &st) || ! S_ISREG(st.st_mode) ) {
+      close(fd);
+      return false;
+    }
+    size = st.st_size;
+    if( size > 0 ) {
+      void* addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if( MAP_FAILED == addr ) {
+        close(fd);
+        return false;
+      }
+      data = (const char*) addr;
+      madvise(addr, size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+    close(fd);
+    return true;
+  }
+  // Start of the line after the one pos is in, size if none
+  long long nextLine(long long pos) const {
+    const char* newline = (const char*) memchr(data + pos, '\n', size - pos);
+    return (NULL == newline) ? size : newline - data + 1;
+  }
+  long long lineEnd(long long pos) const {
+    const char* newline = (const char*) memchr(data + pos, '\n', size - pos);
+    return (NULL == newline) ? size : newline - data;
+  }
+};
+
+
+bool TimeIndex::lineTime(const char* begin, const char* end,
+                         long long& time) {
+  static const char key[] = "\"created_time\"";
+  const char* pos = std::search(begin, end, key, key + sizeof(key) - 1);
+  if( pos == end ) {
+    return false;
+  }
+  pos += sizeof(key) - 1;
+  while( pos < end && (' ' == *pos || '\t' == *pos || ':' == *pos) ) {
+    pos++;
+  }
+  if( pos == end || '"' != *pos ) {
+    return false;
+  }
+  const char* close = (const char*) memchr(pos + 1, '"', end - pos - 1);
+  if( NULL == close || close - pos - 1 > 2 * UTCTIMELEN ) {
+    return false;
+  }
+  std::string mytime = stu::trim(std::string(pos + 1, close), " \t");
+  time = ept::epochParse(mytime.c_str());
+  return time >= 0;
+}
+
+bool TimeIndex::build(const std::string& infname, unsigned int myevery) {
+  mappedfile file;
+  if( ! file.open(infname, true) ) {
+    return false;
+  }
+  filesize = file.size;
+  every = myevery ? myevery : 1;
+  samples.clear();
+  long long maxtime = LLONG_MIN, time;
+  unsigned long long lines = 0;
+  for(long long pos = 0; pos < file.size; lines++) {
+    if( 0 == lines % every ) {
+      timesample sample = {maxtime, pos};
+      samples.push_back(sample);
+    }
+    long long end = file.lineEnd(pos);
+    if( lineTime(file.data + pos, file.data + end, time) && time > maxtime ) {
+      maxtime = time;
+    }
+    pos = end + 1;
+  }
+  if( samples.empty() ) {
+    timesample sample = {LLONG_MIN, 0};
+    samples.push_back(sample);
+  }
+  return true;
+}
+
+bool TimeIndex::save(const std::string& idxname) const {
+  std::ofstream outfile(idxname.c_str());
+  if( ! outfile.is_open() ) {
+    return false;
+  }
+  outfile << "tidx " << filesize << " " << every << '\n';
+  for(std::size_t ii = 0; ii < samples.size(); ii++) {
+    outfile << samples[ii].maxtime << " " << samples[ii].offset << '\n';
+  }
+  return static_cast<bool>(outfile);
+}
+
+bool TimeIndex::load(const std::string& idxname, long long myfilesize) {
+  std::ifstream infile(idxname.c_str());
+  std::string magic;
+  if( ! (infile >> magic >> filesize >> every) || "tidx" != magic
+      || filesize != myfilesize ) {
+    return false;
+  }
+  samples.clear();
+  timesample sample;
+  while( infile >> sample.maxtime >> sample.offset ) {
+    // samples must be ordered both ways, or the index is broken
+    if( sample.offset < 0 || sample.offset > filesize || (! samples.empty()
+        && (sample.offset <= samples.back().offset
+        || sample.maxtime < samples.back().maxtime)) ) {
+      return false;
+    }
+    samples.push_back(sample);
+  }
+  return ! samples.empty() && 0 == samples[0].offset && infile.eof();
+}
+
+long long TimeIndex::seekOffset(long long time) const {
+  // maxtime never decreases, find first sample not older than time
+  std::size_t lo = 0, hi = samples.size();
+  while( lo < hi ) {
+    std::size_t mid = lo + (hi - lo) / 2;
+    if( samples[mid].maxtime < time ) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (0 == lo) ? 0 : samples[lo - 1].offset;
+}
+
+// Keeps lo at a line start known to be older than time - slack, or the
+// start of the file, and moves it up as far as possible. A probe at mid
+// looks at the first line with a time from the next line start on.
+bool TimeIndex::searchOffset(const std::string& infname, long long time,
+                             long long slack, long long& offset) {
+  mappedfile file;
+  if( ! file.open(infname, false) ) {
+    return false;
+  }
+  long long target = time - slack;
+  long long lo = 0, hi = file.size;
+  while( lo < hi ) {
+    long long mid = lo + (hi - lo + 1) / 2;
+    long long pos = ('\n' == file.data[mid - 1]) ? mid : file.nextLine(mid);
+    long long linetime = 0;
+    bool found = false;
+    while( pos < hi && ! found ) {
+      long long end = file.lineEnd(pos);
+      found = lineTime(file.data + pos, file.data + end, linetime);
+      if( ! found ) {
+        pos = end + 1;
+      }
+    }
+    if( found && linetime < target ) {
+      lo = pos;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  offset = lo;
+  return true;
+}
+
+bool TimeIndex::findStart(const std::string& infname, long long time,
+                          long long slack, long long& offset) {
+  struct stat st;
+  if( 0 != stat(infname.c_str(), &st) ) {
+    return false;
+  }
+  TimeIndex index;
+  if( index.load(infname + TIMEINDEXSUFFIX, st.st_size) ) {
+    offset = index.seekOffset(time);
+    return true;
+  }
+  return searchOffset(infname, time, slack, offset);
+}
@@ -0,0 +1,61 @@
+#ifndef TIMEINDEX_H
+#define TIMEINDEX_H
+#include <string>
+#include <vector>
+
+// Lines between two samples of the index
+#define TIMEINDEXEVERY 4096
+
+// Sidecar file of an input file, the input file name with this suffix
+#define TIMEINDEXSUFFIX ".tidx"
+
+// One sample: the start of a line and the newest created_time of all
+// lines before it, so that no earlier line is newer, even when lines
+// are out of order
+struct timesample {
+  long long maxtime;
+  long long offset;
+};
+
+// Sparse index of created_time over byte offsets of an input file, to
+// start reading at the first line that can still matter for a window
+// ending at a given time. The sidecar is a text file:
+//   tidx <file size> <lines per sample>
+//   <maxtime> <offset>
+// one line per sample, the first one always at offset 0. Lines without
+// a readable created_time are skipped, those the parser would reject
+// still count, which can only make the index start earlier.
+class TimeIndex {
+protected:
+  std::vector<timesample> samples;
+  long long filesize;
+  unsigned int every;
+
+public:
+  TimeIndex(): filesize(0), every(TIMEINDEXEVERY) {};
+  // Scan input file, keeping a sample every myevery lines
+  bool build(const std::string& infname,
+             unsigned int myevery = TIMEINDEXEVERY);
+  bool save(const std::string& idxname) const;
+  // Load a sidecar, false if missing, broken or made for a file of
+  // another size
+  bool load(const std::string& idxname, long long myfilesize);
+  // Start of the last sampled line all lines before which are older
+  // than time
+  long long seekOffset(long long time) const;
+  std::size_t sampleCount() const { return samples.size(); }
+
+  // Offset to start reading at to see every line not older than time:
+  // from the sidecar index if there is one for this file, otherwise by
+  // binary search over line starts of the memory mapped file, which
+  // assumes that no line is more than slack seconds older than any
+  // line before it. False if the file cannot be read.
+  static bool findStart(const std::string& infname, long long time,
+                        long long slack, long long& offset);
+  static bool searchOffset(const std::string& infname, long long time,
+                           long long slack, long long& offset);
+  // created_time of the line from begin to end, false if none
+  static bool lineTime(const char* begin, const char* end, long long& time);
+};
+
+#endif
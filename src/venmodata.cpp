@@ -16,6 +16,18 @@ venmodata::~venmodata() {
   free(Contents);
 }
 
+// Assign content only, Contents keeps pointing at our own members
+venmodata& venmodata::operator=(const venmodata& other) {
+  actor = other.actor;
+  target = other.target;
+  time = other.time;
+  epochtime = other.epochtime;
+  sec = other.sec;
+  supplied = other.supplied;
+  amount = other.amount;
+  return *this;
+}
+
 void venmodata::cout() {
     // evaluate data parsed into new object
     std::cout
@@ -9,6 +9,9 @@ public:
   std::string actor, target, time;
   time_t epochtime;
   unsigned int sec, supplied;
+  // optional "amount" in cents, NOAMOUNT if not supplied, see
+  // venmoio::parseWide
+  long long amount;
   // declare last so it can point to actor, target, time
   std::string** Contents;
 
@@ -19,12 +22,15 @@ public:
   static unsigned int FlagAll;
   // Strings containing supported Json tags
   static const char* Names[];
+  static const long long NOAMOUNT = -1;
 
   // initializer list & constructor
   venmodata(std::string actor, std::string target, std::string time,
-            time_t epochtime = 0, int sec = 0, int supplied = 0):
+            time_t epochtime = 0, int sec = 0, int supplied = 0,
+            long long amount = NOAMOUNT):
             actor(actor), target(target), time(time),
-            epochtime(epochtime), sec(sec), supplied(supplied) {
+            epochtime(epochtime), sec(sec), supplied(supplied),
+            amount(amount) {
               // initialize FlagAll to contain all Flags
               for(int ii = 0; ii < NNames; ii++) {
                 FlagAll |= Flags[ii];
@@ -39,6 +45,13 @@ public:
               Contents[1] = &(this->actor);
               Contents[2] = &(this->target);
             };
+  // Copies must point Contents at their own members, so delegate to
+  // the constructor above rather than copying the Contents pointer
+  venmodata(const venmodata& other):
+    venmodata(other.actor, other.target, other.time,
+              other.epochtime, other.sec, other.supplied,
+              other.amount) {};
+  venmodata& operator=(const venmodata& other);
   ~venmodata();
   void cout();
 };
@@ -0,0 +1,113 @@
+#include <string>
+#include <vector>
+#include <algorithm>    // std::sort
+#include <dirent.h>
+#include <sys/stat.h>
+#include "venmodata.h"
+#include "venmoio.h"
+#include "venmofeed.h"
+#include "stringutils.h"
+
+
+// Destructor stops a parser that is still running, e.g. on early exit
+venmofeed::~venmofeed() {
+  queue.close();
+  if( parser.joinable() ) {
+    parser.join();
+  }
+}
+
+void venmofeed::setSymmetric(bool mysymmetric) {
+  symmetric = mysymmetric;
+}
+
+void venmofeed::setWide(bool mywide) {
+  wide = mywide;
+}
+
+void venmofeed::setAmounts(bool myamounts) {
+  amounts = myamounts;
+}
+
+// Launch parser thread
+void venmofeed::start() {
+  parser = std::thread(&venmofeed::parseAll, this);
+}
+
+// Get next block, returns false once all files are parsed
+bool venmofeed::next(venmoblock& block) {
+  return queue.pop(block);
+}
+
+const std::string& venmofeed::getFile(unsigned int index) const {
+  return files[index];
+}
+
+// Parser thread body: parse files in sequence, keep only lines with
+// all Json tags supplied, just like the single file loop in main
+void venmofeed::parseAll() {
+  venmodata vdt("", "", "");
+  for(unsigned int ii = 0; ii < files.size(); ii++) {
+    venmoio vio;
+    vio.setSymmetric(symmetric);
+    vio.setWide(wide);
+    vio.setAmounts(amounts);
+    if( ! vio.openInput(files[ii].c_str()) ) {
+      stu::abortf("Cannot read input file %s\n", files[ii].c_str());
+    }
+    venmoblock block;
+    block.file = ii;
+    block.first = true;
+    block.records.reserve(blocksize);
+    while( vio.parseLine(&vdt) ) {
+      if( vdt.FlagAll == vdt.supplied ) {
+        block.records.push_back(vdt);
+        if( block.records.size() >= blocksize ) {
+          if( ! queue.push(std::move(block)) ) {
+            return;
+          }
+          block = venmoblock();
+          block.file = ii;
+          block.records.reserve(blocksize);
+        }
+      }
+    }
+    block.last = true;
+    if( ! queue.push(std::move(block)) ) {
+      return;
+    }
+  }
+  queue.close();
+}
+
+// Expand path into files: a regular file is taken as is, a directory
+// contributes its regular files (no subdirectories) in lexicographic order,
+// which matches hourly file names such as 2016-04-07T03.txt
+void venmofeed::listInputs(const char* path, std::vector<std::string>& files) {
+  struct stat st;
+  if( 0 != stat(path, &st) ) {
+    stu::abortf("Cannot access input %s\n", path);
+  }
+  if( ! S_ISDIR(st.st_mode) ) {
+    files.push_back(path);
+    return;
+  }
+  DIR* dir = opendir(path);
+  if( NULL == dir ) {
+    stu::abortf("Cannot open input directory %s\n", path);
+  }
+  std::vector<std::string> found;
+  struct dirent* entry;
+  while( NULL != (entry = readdir(dir)) ) {
+    if( '.' == entry->d_name[0] ) {
+      continue;
+    }
+    std::string fname = std::string(path) + "/" + entry->d_name;
+    if( 0 == stat(fname.c_str(), &st) && S_ISREG(st.st_mode) ) {
+      found.push_back(fname);
+    }
+  }
+  closedir(dir);
+  std::sort(found.begin(), found.end());
+  files.insert(files.end(), found.begin(), found.end());
+}
@@ -0,0 +1,50 @@
+#ifndef VENMOFEED_H
+#define VENMOFEED_H
+#include <string>
+#include <vector>
+#include <thread>
+#include "venmodata.h"
+#include "blockqueue.h"
+
+// Block of parsed records from one input file. Blocks of a file arrive in
+// order, the first one flagged with first = true (it may hold no records
+// if the file is empty), the last one with last = true.
+struct venmoblock {
+  unsigned int file;
+  bool first, last;
+  std::vector<venmodata> records;
+  venmoblock(): file(0), first(false), last(false) {};
+};
+
+// Parses a list of input files on a helper thread, one after the other,
+// and hands complete valid records to the consumer in blocks. The queue
+// in between is bounded, so parsing runs at most a few blocks ahead of
+// graph processing.
+class venmofeed {
+protected:
+  std::vector<std::string> files;
+  BlockQueue<venmoblock> queue;
+  std::thread parser;
+  std::size_t blocksize;
+  bool symmetric, wide, amounts;
+  void parseAll();
+
+public:
+  venmofeed(const std::vector<std::string>& files,
+            std::size_t blocksize = 4096, std::size_t nblocks = 8):
+    files(files), queue(nblocks), blocksize(blocksize), symmetric(true),
+    wide(false), amounts(false) {};
+  ~venmofeed();
+  // Keep actor and target order for directed engines, call before start
+  void setSymmetric(bool mysymmetric);
+  void setWide(bool mywide);
+  void setAmounts(bool myamounts);
+  void start();
+  bool next(venmoblock& block);
+  const std::string& getFile(unsigned int index) const;
+
+  // Expand a file or a directory into a sorted list of regular files
+  static void listInputs(const char* path, std::vector<std::string>& files);
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>      // strtoul, strtod
+#include <getopt.h>
+#include "streamgen.h"
+#include "stringutils.h"
+
+
+// Generator of synthetic input files for benchmarks and engine comparisons
+
+void usage(const char* prog) {
+  stu::abortf("usage: %s [options] <outputfile>\n"
+    "  -n <records>   number of records (100000)\n"
+    "  -u <users>     number of distinct users (10000)\n"
+    "  -r <rate>      mean records per second (50)\n"
+    "  -d <seconds>   maximum lag of out of order records (0)\n"
+    "  -H <fraction>  fraction of records sent by hubs (0)\n"
+    "  -k <hubs>      number of hub users (10)\n"
+    "  -s <seed>      random seed (1)\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+  streamspec spec;
+  int opt;
+  while( -1 != (opt = getopt(argc, argv, "n:u:r:d:H:k:s:")) ) {
+    switch( opt ) {
+      case 'n': spec.nrec = strtoul(optarg, NULL, 10); break;
+      case 'u': spec.nusers = strtoul(optarg, NULL, 10); break;
+      case 'r': spec.rate = strtod(optarg, NULL); break;
+      case 'd': spec.disorder = strtoul(optarg, NULL, 10); break;
+      case 'H': spec.hubfrac = strtod(optarg, NULL); break;
+      case 'k': spec.nhubs = strtoul(optarg, NULL, 10); break;
+      case 's': spec.seed = strtoul(optarg, NULL, 10); break;
+      default: usage(argv[0]);
+    }
+  }
+  if( argc - optind != 1 || spec.nusers < 2 || spec.rate <= 0.0
+      || 0 == spec.nhubs || spec.nhubs > spec.nusers ) {
+    usage(argv[0]);
+  }
+
+  std::ofstream outfile(argv[optind]);
+  if( ! outfile.is_open() ) {
+    stu::abortf("Cannot write %s\n", argv[optind]);
+  }
+  streamgen gen(spec);
+  std::string line;
+  while( gen.next(line) ) {
+    outfile << line << '\n';
+  }
+  return 0;
+}
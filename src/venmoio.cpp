@@ -2,6 +2,8 @@
 #include <fstream>      // std:ifstream std::ofstream
 #include <cstring>      // strncpy
 #include <limits>       // std::numeric_limits
+#include <cmath>        // llround
+#include <cstdlib>      // strtod
 #include <stdio.h>
 #include <libgen.h>
 #include <sys/stat.h>
@@ -9,23 +11,78 @@
 #include "venmodata.h"
 #include "epochtime.h"
 #include "stringutils.h"
+#include "fieldhash.h"
+#include "probes.h"
 
 
 // Constructor opens files and creates output directory of needed
-venmoio::venmoio(const char* infname, const char* outfname) {
+venmoio::venmoio(const char* infname, const char* outfname):
+  zbuf(NULL), infile(NULL), symmetric(true), wide(false) {
+  openInput(infname);
+  openOutput(outfname);
+}
+
+// (Re)open input file, returns false if it cannot be read.
+// gzip and zstd compressed files are recognized by content and
+// decompressed on the fly by a helper thread, see decompress.h
+bool venmoio::openInput(const char* infname) {
+  closeInput();
+  infile.clear();
+  int format = decompbuf::detect(infname);
+  if( FORMAT_PLAIN == format ) {
+    if( NULL == inbuf.open(infname, std::ios::in) ) {
+      return false;
+    }
+    infile.rdbuf(&inbuf);
+  } else {
+    zbuf = new decompbuf();
+    if( ! zbuf->open(infname, format) ) {
+      closeInput();
+      return false;
+    }
+    infile.rdbuf(zbuf);
+  }
+  return true;
+}
+
+// Offsets are those of the file, so only plain input can seek
+bool venmoio::seekInput(long long offset) {
+  if( NULL != zbuf || ! inbuf.is_open() ) {
+    return false;
+  }
+  infile.clear();
+  return inbuf.pubseekpos(offset, std::ios::in) == std::streampos(offset);
+}
+
+void venmoio::closeInput() {
+  infile.rdbuf(NULL);
+  if( inbuf.is_open() ) {
+    inbuf.close();
+  }
+  delete zbuf;
+  zbuf = NULL;
+}
+
+// (Re)open output file, closing any previous one, so that a single
+// venmoio object can write one output per input file in batch mode
+void venmoio::openOutput(const char* outfname) {
   // Input file must exist but output file directory may not exist
   // It will be only a single directory level, so no subdirs handled
   // Error may occur if directory exists but no need to catch that
   char myoutfname[MAXSTRLEN];
   strncpy(myoutfname, outfname, MAXSTRLEN);
+  myoutfname[MAXSTRLEN - 1] = '\0';
   mkdir(dirname(myoutfname), 0755);
-  infile.open(infname);
+  if( outfile.is_open() ) {
+    outfile.close();
+  }
+  outfile.clear();
   outfile.open(outfname);
 }
 
 // Destructor closes files
 venmoio::~venmoio() {
-  infile.close();
+  closeInput();
   outfile.close();
 }
 
@@ -35,10 +92,16 @@ venmoio::~venmoio() {
 // otherwise marks entry to be ignored
 bool venmoio::parseLine(venmodata* vdt) {
 
-#define IGNOREINPUT { vdt->supplied = vdt->FlagNone; return true; }
+#define IGNOREINPUT(reason) { PROBE1(record_rejected, reason); \
+  vdt->supplied = vdt->FlagNone; return true; }
+
+  if( wide ) {
+    return parseWide(vdt);
+  }
 
   // Reset venmodata to no content supplied
   vdt->supplied = vdt->FlagNone;
+  vdt->amount = vdt->NOAMOUNT;
 
   // I want to load a limited number of characters to prevent buffer
   // overflow. istream.get requires a (char*) buffer to supply
@@ -77,7 +140,7 @@ bool venmoio::parseLine(venmodata* vdt) {
 
     // Last character must be curly brace, otherwise reject input.
     if( ! stu::endAssert(Input, "}") ) {
-      IGNOREINPUT
+      IGNOREINPUT("syntax")
     }
 
     // String holding Json name and content
@@ -90,15 +153,15 @@ bool venmoio::parseLine(venmodata* vdt) {
       bool hasContent = stu::popQuoted(Input, InputContent);
       // Is whitespace reduced content empty?
       if( 0 == InputContent.length() ) {
-        IGNOREINPUT
+        IGNOREINPUT("syntax")
       }
       bool hasColon = stu::endAssert(Input, ":");
       bool hasName = stu::popQuoted(Input, InputName);
       if( 0 == InputName.length() ) {
-        IGNOREINPUT
+        IGNOREINPUT("syntax")
       }
       if( ! (hasName && hasColon && hasContent) ) {
-        IGNOREINPUT
+        IGNOREINPUT("syntax")
       }
 
       // Note: replace this by hash lookup to support many Json
@@ -109,7 +172,7 @@ bool venmoio::parseLine(venmodata* vdt) {
           // Check if it has been supplied already.
           // If yes, ignore whole line.
           if( vdt->supplied & vdt->Flags[NameOption] ) {
-            IGNOREINPUT
+            IGNOREINPUT("duplicate")
           }
           // mark this content as supplied
           vdt->supplied |= vdt->Flags[NameOption];
@@ -122,36 +185,267 @@ bool venmoio::parseLine(venmodata* vdt) {
     // Remaining character must be curly brace, otherwise
     // reject whole input line
     if( ! stu::endAssert(Input, "{") ) {
-      IGNOREINPUT
+      IGNOREINPUT("syntax")
     }
     if( 0 < Input.length() ) {
-      IGNOREINPUT
+      IGNOREINPUT("syntax")
+    }
+    if( vdt->FlagAll != vdt->supplied ) {
+      IGNOREINPUT("missing")
     }
 
-    // edges are non-directional, so swap if needed to obtain
-    // lexicographically ordered actor <= target
-    if( vdt->actor > vdt->target ) {
-      std::string tempstr = vdt->actor;
-      vdt->actor = vdt->target;
-      vdt->target = tempstr;
+    if( ! completeRecord(vdt) ) {
+      IGNOREINPUT("time")
     }
+    PROBE1(record_parsed, vdt->epochtime);
+  }
+
+  return Result;
+}
 
-    if( ! stu::getSec(vdt->time, vdt->sec) ) {
-      IGNOREINPUT
+// Order end nodes and parse the time of a record with all contents
+// supplied, returns false if the time is invalid
+bool venmoio::completeRecord(venmodata* vdt) {
+  // edges are non-directional, so swap if needed to obtain
+  // lexicographically ordered actor <= target
+  if( symmetric && vdt->actor > vdt->target ) {
+    std::string tempstr = vdt->actor;
+    vdt->actor = vdt->target;
+    vdt->target = tempstr;
+  }
+
+  if( ! stu::getSec(vdt->time, vdt->sec) ) {
+    return false;
+  }
+
+  if( (vdt->epochtime = ept::epochParse(vdt->time.c_str())) < 0 ) {
+    return false;
+  }
+  return true;
+}
+
+// Json scanning for parseWide, each returns the position after what it
+// skipped, or NULL if the line ends before or the syntax is wrong
+
+static const char* skipSpace(const char* pos, const char* end) {
+  while( pos < end && (' ' == *pos || '\t' == *pos || '\r' == *pos
+                       || '\n' == *pos || '\f' == *pos || '\v' == *pos) ) {
+    pos++;
+  }
+  return pos;
+}
+
+// String starting at the opening quote at pos, with escapes
+static const char* skipString(const char* pos, const char* end) {
+  for(pos++; pos < end; pos++) {
+    if( '"' == *pos ) {
+      return pos + 1;
     }
+    if( '\\' == *pos ) {
+      pos++;
+    }
+  }
+  return NULL;
+}
 
-    if( (vdt->epochtime = ept::epochParse(vdt->time.c_str())) < 0 ) {
-      IGNOREINPUT
+// Any value: a string, an object or array with all values nested in it,
+// which only need balanced brackets, or a number or literal up to the
+// next delimiter
+static const char* skipValue(const char* pos, const char* end) {
+  if( pos >= end ) {
+    return NULL;
+  }
+  if( '"' == *pos ) {
+    return skipString(pos, end);
+  }
+  if( '{' == *pos || '[' == *pos ) {
+    int depth = 0;
+    while( pos < end ) {
+      char cc = *pos;
+      if( '"' == cc ) {
+        if( NULL == (pos = skipString(pos, end)) ) {
+          return NULL;
+        }
+        continue;
+      }
+      if( '{' == cc || '[' == cc ) {
+        depth++;
+      } else if( '}' == cc || ']' == cc ) {
+        if( 0 == --depth ) {
+          return pos + 1;
+        }
+      }
+      pos++;
     }
+    return NULL;
+  }
+  const char* start = pos;
+  while( pos < end && ',' != *pos && '}' != *pos && ']' != *pos
+         && ' ' != *pos && '\t' != *pos && '\r' != *pos ) {
+    pos++;
   }
+  return (pos == start) ? NULL : pos;
+}
 
-  return Result;
+// Amount in cents of a number, also in quotes, NOAMOUNT unless it is a
+// finite number of at least 0
+static long long parseAmount(const char* pos, const char* end) {
+  if( '"' == *pos ) {
+    pos++;
+    end--;
+  }
+  std::string number(pos, end - pos);
+  char* numend;
+  double dollars = strtod(number.c_str(), &numend);
+  if( numend == number.c_str() || '\0' != *numend
+      || !(dollars >= 0.0 && dollars < 1e15) ) {
+    return venmodata::NOAMOUNT;
+  }
+  return llround(dollars * 100);
+}
+
+// Parse a wide record: a one-line Json object with "actor", "target"
+// and "created_time" among any number of other fields, in any order.
+// One left to right pass finds each key, looks it up in the perfect
+// hash of fieldhash.h and copies only the three projected values, which
+// must be strings, and the optional amount. Other values, also nested
+// objects and arrays, are skipped without being copied or checked
+// beyond their brackets and quotes. With setAmounts the amount is read
+// too, and an amount that is no number, below 0 or 1e15 dollars or more
+// rejects the line, otherwise it is skipped as any other value. Lines
+// are read up to MAXWIDELEN characters.
+bool venmoio::parseWide(venmodata* vdt) {
+  vdt->supplied = vdt->FlagNone;
+  vdt->amount = vdt->NOAMOUNT;
+  bool hasamount = false;
+  if( widebuf.empty() ) {
+    widebuf.resize(MAXWIDELEN);
+  }
+  if( ! infile.get(&widebuf[0], MAXWIDELEN) ) {
+    return false;
+  }
+  const char* pos = &widebuf[0];
+  const char* end = pos + infile.gcount();
+  // a full buffer not followed by the newline is a longer line
+  bool truncated = (MAXWIDELEN - 1 == infile.gcount()
+    && std::char_traits<char>::eof() != infile.peek()
+    && '\n' != infile.peek());
+  // as in parseLine, a final line without newline is fine
+  infile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  if( truncated ) {
+    IGNOREINPUT("length")
+  }
+
+  pos = skipSpace(pos, end);
+  if( pos == end || '{' != *pos ) {
+    IGNOREINPUT("syntax")
+  }
+  pos = skipSpace(pos + 1, end);
+  while( true ) {
+    if( pos == end || '"' != *pos ) {
+      IGNOREINPUT("syntax")
+    }
+    const char* name = pos + 1;
+    if( NULL == (pos = skipString(pos, end)) ) {
+      IGNOREINPUT("syntax")
+    }
+    int key = fieldhash::lookup(name, pos - 1 - name);
+    // an untracked amount is skipped as any other field
+    if( fieldhash::amount == key && ! amounts ) {
+      key = -1;
+    }
+    pos = skipSpace(pos, end);
+    if( pos == end || ':' != *pos ) {
+      IGNOREINPUT("syntax")
+    }
+    pos = skipSpace(pos + 1, end);
+    if( key < 0 ) {
+      if( NULL == (pos = skipValue(pos, end)) ) {
+        IGNOREINPUT("syntax")
+      }
+    } else if( fieldhash::amount == key ) {
+      const char* value = pos;
+      if( NULL == (pos = skipValue(pos, end)) ) {
+        IGNOREINPUT("syntax")
+      }
+      if( hasamount ) {
+        IGNOREINPUT("duplicate")
+      }
+      hasamount = true;
+      vdt->amount = parseAmount(value, pos);
+      if( vdt->NOAMOUNT == vdt->amount ) {
+        IGNOREINPUT("amount")
+      }
+    } else {
+      if( pos == end || '"' != *pos ) {
+        IGNOREINPUT("syntax")
+      }
+      const char* content = pos + 1;
+      if( NULL == (pos = skipString(pos, end)) ) {
+        IGNOREINPUT("syntax")
+      }
+      // duplicates reject the line as in parseLine
+      if( vdt->supplied & vdt->Flags[key] ) {
+        IGNOREINPUT("duplicate")
+      }
+      vdt->supplied |= vdt->Flags[key];
+      // same whitespace reduction as stu::popQuoted
+      std::string& mycontent = *(vdt->Contents[key]);
+      mycontent.assign(content, pos - 1 - content);
+      if( std::string::npos != mycontent.find_first_of(" \t") ) {
+        mycontent = stu::reduce(mycontent, " \t", " ");
+      }
+      if( mycontent.empty() ) {
+        IGNOREINPUT("syntax")
+      }
+    }
+    pos = skipSpace(pos, end);
+    if( pos == end ) {
+      IGNOREINPUT("syntax")
+    }
+    if( '}' == *pos ) {
+      break;
+    }
+    if( ',' != *pos ) {
+      IGNOREINPUT("syntax")
+    }
+    pos = skipSpace(pos + 1, end);
+  }
+  if( skipSpace(pos + 1, end) != end ) {
+    IGNOREINPUT("syntax")
+  }
+  if( vdt->FlagAll != vdt->supplied ) {
+    IGNOREINPUT("missing")
+  }
+  if( ! completeRecord(vdt) ) {
+    IGNOREINPUT("time")
+  }
+  PROBE1(record_parsed, vdt->epochtime);
+  return true;
+}
+
+// Directed engines need actor and target as given
+void venmoio::setSymmetric(bool mysymmetric) {
+  symmetric = mysymmetric;
+}
+
+void venmoio::setWide(bool mywide) {
+  wide = mywide;
+}
+
+void venmoio::setAmounts(bool myamounts) {
+  amounts = myamounts;
 }
 
 void venmoio::outStr(std::string str) {
   outfile << str;
 }
 
+// Raw output for the binary format of binout.h
+void venmoio::outBytes(const char* data, std::size_t len) {
+  outfile.write(data, len);
+}
+
 // UNIT TESTING below
 // ==================
 
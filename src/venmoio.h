@@ -2,17 +2,48 @@
 #define VENMOIO_H
 #include <iostream>
 #include <fstream>
+#include <vector>
 #include "venmodata.h"
+#include "decompress.h"
+
+// Longest line of a wide record, longer lines are ignored
+#define MAXWIDELEN 65536
 
 class venmoio {
 protected:
-  std::ifstream infile;
+  // infile reads either plain filebuf or decompressing zbuf
+  std::filebuf inbuf;
+  decompbuf* zbuf;
+  std::istream infile;
   std::ofstream outfile;
+  // order actor <= target for non-directional edges
+  bool symmetric;
+  // accept wide records, see parseWide
+  bool wide;
+  // check the "amount" of wide records, see parseWide
+  bool amounts;
+  std::vector<char> widebuf;
+  void closeInput();
+  bool parseWide(venmodata* vdt);
+  bool completeRecord(venmodata* vdt);
 public:
+  venmoio(): zbuf(NULL), infile(NULL), symmetric(true), wide(false),
+    amounts(false) {};
   venmoio(const char* infname, const char* outfname);
   ~venmoio();
+  bool openInput(const char* infname);
+  // Continue reading at byte offset, false for compressed input
+  bool seekInput(long long offset);
+  void openOutput(const char* outfname);
+  void setSymmetric(bool mysymmetric);
+  // Parse lines with any further Json fields, skipping them, see parseWide
+  void setWide(bool mywide);
+  // Read the amount of wide records, rejecting those whose amount is
+  // invalid, instead of skipping it as any other field
+  void setAmounts(bool myamounts);
   bool parseLine(venmodata* vdt);
   void outStr(std::string str);
+  void outBytes(const char* data, std::size_t len);
   bool testLine();
 };
 